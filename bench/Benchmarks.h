@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Utils/JsonWriter.h"
+
+namespace BgfxSlangBench {
+
+void runGlslRewriteBench(JsonWriter &json);
+void runBin2cBench(JsonWriter &json);
+void runCompileBench(JsonWriter &json);
+
+} // namespace BgfxSlangBench
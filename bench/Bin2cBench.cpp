@@ -0,0 +1,132 @@
+#include "Benchmarks.h"
+#include "BgfxSlang/Utils/Bin2cWriter.h"
+#include "Utils/JsonWriter.h"
+#include "Utils/Timer.h"
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <ios>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlangBench {
+
+namespace {
+constexpr int iterations = 5;
+constexpr int compileIterations = 3;
+
+struct Mode {
+  std::string_view Name;
+  BgfxSlang::Bin2cFormat Format;
+};
+
+constexpr Mode modes[] = {
+    {"ascii", BgfxSlang::Bin2cFormat::Ascii},
+    {"bytes", BgfxSlang::Bin2cFormat::Bytes},
+    {"words", BgfxSlang::Bin2cFormat::Words},
+    {"embed", BgfxSlang::Bin2cFormat::Embed},
+};
+
+// SPIR-V like data, mostly small little endian words
+std::vector<uint8_t> makeData(size_t size) {
+  std::vector<uint8_t> data(size);
+  uint32_t state = 0x12345678;
+  for (size_t i = 0; i < size; i++) {
+    state = state * 1664525 + 1013904223;
+    data[i] = i % 4 == 0 ? static_cast<uint8_t>(state >> 24) : (i % 4 == 1 ? static_cast<uint8_t>(state >> 28) : 0);
+  }
+  return data;
+}
+
+// previous implementation, every byte formatted with iostream manipulators
+std::string encodeWithStream(std::string_view varName, const std::vector<uint8_t> &buffer) {
+  constexpr size_t bytesPerLine = 16;
+  std::ostringstream file;
+  file << "static const uint8_t " << varName << "[" << buffer.size() << "] =\n{\n";
+  for (size_t i = 0; i < buffer.size(); i += bytesPerLine) {
+    file << "  ";
+    for (size_t j = i; j < i + bytesPerLine && j < buffer.size(); ++j) {
+      file << "0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(buffer[j]) << ", ";
+    }
+    size_t bytesInLine = ((i + bytesPerLine) <= buffer.size()) ? bytesPerLine : (buffer.size() - i);
+    if (bytesInLine < bytesPerLine) {
+      file << std::string((bytesPerLine - bytesInLine) * 6, ' ');
+    }
+    file << "// ";
+    for (size_t j = i; j < i + bytesPerLine && j < buffer.size(); ++j) {
+      file << (std::isprint(buffer[j]) != 0 ? static_cast<char>(buffer[j]) : '.');
+    }
+    file << "\n";
+  }
+  file << "};\n";
+  return file.str();
+}
+
+// Compiles translation unit including the header with the compiler from CXX environment variable (default: c++).
+// Returns false when the compiler fails, for example when it doesn't support #embed.
+bool compileHeader(const std::filesystem::path &directory, const std::string &headerName, uint64_t &outNs) {
+  const auto sourcePath = directory / (headerName + ".cpp");
+  std::ofstream(sourcePath) << "#include <cstdint>\n#include \"" << headerName << "\"\nconst void *data = shader;\n";
+
+  const char *compiler = std::getenv("CXX");
+  const auto command = std::string(compiler != nullptr ? compiler : "c++") + " -std=c++20 -c \"" + sourcePath.string() + "\" -o \"" +
+                       (directory / (headerName + ".o")).string() + "\"";
+
+  bool succeeded = true;
+  outNs = measureNs(compileIterations, [&]() { succeeded = std::system(command.c_str()) == 0 && succeeded; });
+  return succeeded;
+}
+} // namespace
+
+void runBin2cBench(JsonWriter &json) {
+  const auto directory = std::filesystem::temp_directory_path() / "bgfx-slang-bench";
+  std::filesystem::create_directories(directory);
+
+  json.BeginArray("results");
+  for (size_t size = 16 * 1024; size <= 1024 * 1024; size *= 4) {
+    const auto data = makeData(size);
+
+    std::string streamResult;
+    auto streamNs = measureNs(iterations, [&]() { streamResult = encodeWithStream("shader", data); });
+
+    for (const auto &mode : modes) {
+      const auto headerName = "bin2c_" + std::string(mode.Name) + "_" + std::to_string(size) + ".h";
+      const auto headerPath = (directory / headerName).string();
+      const auto dataPath = BgfxSlang::Bin2cWriter::GetEmbedDataPath(headerPath);
+      const auto embedPath = std::filesystem::path(dataPath).filename().string();
+
+      std::string result;
+      auto generateNs = measureNs(iterations, [&]() { result = BgfxSlang::Bin2cWriter::Encode("shader", mode.Format, data, embedPath); });
+
+      std::ofstream(headerPath, std::ios::binary) << result;
+      if (mode.Format == BgfxSlang::Bin2cFormat::Embed) {
+        std::ofstream(dataPath, std::ios::binary).write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(size));
+      }
+
+      uint64_t compileNs = 0;
+      const bool compiled = compileHeader(directory, headerName, compileNs);
+
+      json.BeginObject();
+      json.Value("mode", mode.Name);
+      json.Value("dataBytes", static_cast<uint64_t>(size));
+      json.Value("headerBytes", static_cast<uint64_t>(result.size()));
+      json.Value("generateNs", generateNs);
+      json.Value("compiled", compiled);
+      json.Value("compileNs", compileNs);
+      if (mode.Format == BgfxSlang::Bin2cFormat::Ascii) {
+        json.Value("streamNs", streamNs);
+        json.Value("sameOutput", streamResult == result);
+      }
+      json.EndObject();
+    }
+  }
+  json.EndArray();
+}
+
+} // namespace BgfxSlangBench
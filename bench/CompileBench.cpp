@@ -0,0 +1,222 @@
+#include "Benchmarks.h"
+#include "BgfxSlang/Compiler.h"
+#include "BgfxSlang/GlobalSessionPool.h"
+#include "BgfxSlang/Target.h"
+#include "BgfxSlang/Utils/BufferWriter.h"
+#include "BgfxSlang/Utils/FileWriter.h"
+#include "BgfxSlang/Utils/Hash.h"
+#include "BgfxSlang/Utils/Trace.h"
+#include "Utils/JsonWriter.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlangBench {
+
+namespace {
+constexpr int iterations = 3;
+constexpr int stressUniformCount = 256;
+constexpr int stressEntryPointCount = 64;
+constexpr int stressStructDepth = 8;
+
+struct Shader {
+  std::string Name;
+  std::string Source;
+};
+
+struct PhaseTotal {
+  uint64_t Ns = 0;
+  uint64_t Count = 0;
+};
+
+// Sums the spans of every phase, the compiler adds them from its worker threads.
+class PhaseSink : public BgfxSlang::ITraceSink {
+public:
+  void AddSpan(std::string_view name, uint64_t /*startNs*/, uint64_t durationNs) override {
+    std::lock_guard lock(mutex);
+    auto &phase = phases[std::string(name)];
+    phase.Ns += durationNs;
+    phase.Count++;
+  }
+
+  [[nodiscard]] const std::map<std::string, PhaseTotal> &GetPhases() const { return phases; }
+
+private:
+  std::mutex mutex;
+  std::map<std::string, PhaseTotal> phases;
+};
+
+std::string readFile(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+std::string makeManyUniformsShader() {
+  std::string source;
+  std::string body = "  float4 acc = float4(0.0);\n";
+  for (int i = 0; i < stressUniformCount; i++) {
+    source += "uniform float4 u_param" + std::to_string(i) + ";\n";
+    body += "  acc += u_param" + std::to_string(i) + " * input.color;\n";
+  }
+  return source + "\nstruct Vertex {\n  float4 sv_position : SV_Position;\n  float4 color : COLOR;\n};\n\n"
+                  "[shader(\"fragment\")]\nfloat4 fragmentMain(Vertex input) : SV_Target {\n" +
+         body + "  return acc;\n}\n";
+}
+
+std::string makeManyEntryPointsShader() {
+  std::string source = "uniform float4 u_color;\n\nstruct Vertex {\n  float4 sv_position : SV_Position;\n  float4 color : COLOR;\n};\n";
+  for (int i = 0; i < stressEntryPointCount; i++) {
+    source += "\n[shader(\"fragment\")]\nfloat4 fragmentMain" + std::to_string(i) +
+              "(Vertex input) : SV_Target { return input.color * u_color * " + std::to_string(i + 1) + ".0; }\n";
+  }
+  return source;
+}
+
+// vertex input nested stressStructDepth levels deep, every level adds one texcoord
+std::string makeDeepStructShader() {
+  std::string source = "struct Level0 {\n  float4 value : TEXCOORD0;\n};\n";
+  for (int i = 1; i < stressStructDepth; i++) {
+    source += "struct Level" + std::to_string(i) + " {\n  Level" + std::to_string(i - 1) + " inner;\n  float4 value : TEXCOORD" +
+              std::to_string(i) + ";\n};\n";
+  }
+
+  std::string sum = "float4(0.0)";
+  std::string path = "input";
+  for (int i = 0; i < stressStructDepth; i++) {
+    sum += " + " + path + ".value";
+    path += ".inner";
+  }
+  return source + "\nstruct Vertex {\n  float4 sv_position : SV_Position;\n  float4 color : COLOR;\n};\n\n"
+                  "[shader(\"vertex\")]\nVertex vertexMain(Level" +
+         std::to_string(stressStructDepth - 1) + " input, float3 position : POSITION) {\n  Vertex output;\n" +
+         "  output.sv_position = float4(position, 1.0);\n  output.color = " + sum + ";\n  return output;\n}\n";
+}
+
+std::vector<Shader> getShaders() {
+  const std::filesystem::path examples = BGFXSLANG_EXAMPLES_DIR;
+  return {
+      {"cubes", readFile(examples / "01-cubes" / "cubes.slang")},
+      {"instancing", readFile(examples / "05-instancing" / "instancing.slang")},
+      {"bump", readFile(examples / "06-bump" / "bump.slang")},
+      {"nbody", readFile(examples / "24-nbody" / "nbody.slang")},
+      {"particle", readFile(examples / "24-nbody" / "particle.slang")},
+      {"stress-uniforms", makeManyUniformsShader()},
+      {"stress-entry-points", makeManyEntryPointsShader()},
+      {"stress-deep-structs", makeDeepStructShader()},
+  };
+}
+
+// Profiles with distinct slang profile, the aliases (dx, spirv, glsl, gles) would compile the same code again.
+std::vector<BgfxSlang::TargetProfile> getTargets() {
+  std::vector<BgfxSlang::TargetProfile> result;
+  for (const auto &profile : BgfxSlang::targetProfiles) {
+    bool found = false;
+    for (const auto &added : result) {
+      found |= added.Id == profile.Id;
+    }
+    if (!found) {
+      result.push_back(profile);
+    }
+  }
+  return result;
+}
+
+// Loads the shader and compiles all its entry points for the target, the blobs are written to the directory. outHash is hash of
+// all the blobs, the runs must produce the same.
+std::string compileShader(const Shader &shader, const BgfxSlang::TargetProfile &target, BgfxSlang::GlobalSessionPool &pool,
+                          const std::filesystem::path &directory, PhaseSink &sink, uint64_t &outBytes, uint64_t &outHash) {
+  BgfxSlang::Compiler compiler;
+  compiler.SetGlobalSessionPool(&pool);
+  compiler.SetTraceSink(&sink);
+  compiler.AddModulesSearchPath(std::string(BGFXSLANG_EXAMPLES_DIR) + "/lib");
+
+  if (auto status = compiler.AddTarget(target.Name); status.IsError()) {
+    return std::string(status.GetMessage());
+  }
+  if (auto status = compiler.LoadProgram(shader.Source); status.IsError()) {
+    return std::string(status.GetMessage());
+  }
+
+  outBytes = 0;
+  outHash = BgfxSlang::fnv1a64Offset;
+  for (int64_t i = 0; i < static_cast<int64_t>(compiler.GetEntryPointCount()); i++) {
+    BgfxSlang::BufferWriter buffer;
+    if (auto status = compiler.Compile(i, 0, buffer); status.IsError()) {
+      return std::string(status.GetMessage());
+    }
+
+    BgfxSlang::ScopedSpan span(&sink, "write-out");
+    BgfxSlang::FileWriter writer;
+    writer.Open((directory / (shader.Name + "_" + std::to_string(i) + "_" + std::string(target.Name) + ".bin")).string());
+    writer.WriteShared(buffer.GetData(), nullptr);
+    if (!writer.Close()) {
+      return "Failed to write output";
+    }
+    outBytes += buffer.GetData().size();
+    outHash = BgfxSlang::fnv1a64({reinterpret_cast<const char *>(buffer.GetData().data()), buffer.GetData().size()}, outHash);
+  }
+  return {};
+}
+} // namespace
+
+void runCompileBench(JsonWriter &json) {
+  const auto directory = std::filesystem::temp_directory_path() / "bgfx-slang-bench" / "compile";
+  std::filesystem::create_directories(directory);
+
+  // shared like in the tool, the first compilation pays for the global session
+  BgfxSlang::GlobalSessionPool pool;
+
+  json.BeginArray("results");
+  for (const auto &shader : getShaders()) {
+    for (const auto &target : getTargets()) {
+      PhaseSink sink;
+      std::string error;
+      uint64_t outputBytes = 0;
+      uint64_t firstHash = 0;
+      bool deterministic = true;
+      int runs = 0;
+      const auto startNs = BgfxSlang::ITraceSink::GetTimeNs();
+      for (; runs < iterations && error.empty(); runs++) {
+        uint64_t hash = 0;
+        error = compileShader(shader, target, pool, directory, sink, outputBytes, hash);
+        firstHash = runs == 0 ? hash : firstHash;
+        deterministic &= hash == firstHash;
+      }
+      const auto totalNs = BgfxSlang::ITraceSink::GetTimeNs() - startNs;
+
+      json.BeginObject();
+      json.Value("shader", shader.Name);
+      json.Value("target", target.Name);
+      json.Value("succeeded", error.empty());
+      if (!error.empty()) {
+        json.Value("error", error);
+      }
+      json.Value("outputBytes", outputBytes);
+      // byte-identical blobs from every run, the shared cache relies on it
+      json.Value("deterministic", deterministic);
+      // averages of one run
+      json.Value("totalNs", totalNs / runs);
+      json.BeginObject("phases");
+      for (const auto &[name, phase] : sink.GetPhases()) {
+        json.BeginObject(name);
+        json.Value("ns", phase.Ns / runs);
+        json.Value("count", phase.Count / runs);
+        json.EndObject();
+      }
+      json.EndObject();
+      json.EndObject();
+    }
+  }
+  json.EndArray();
+}
+
+} // namespace BgfxSlangBench
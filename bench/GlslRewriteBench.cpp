@@ -0,0 +1,95 @@
+#include "Benchmarks.h"
+#include "BgfxSlang/GlslRewriter.h"
+#include "Utils/JsonWriter.h"
+#include "Utils/Timer.h"
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace BgfxSlangBench {
+
+namespace {
+constexpr int iterations = 5;
+constexpr int regexMaxUniforms = 128;
+constexpr int usesPerUniform = 4;
+
+struct SyntheticShader {
+  std::string Source;
+  BgfxSlang::UniformBufferRewrite Buffer;
+};
+
+// GLSL in the shape produced by SPIRV-Cross with emit_uniform_buffer_as_plain_uniforms, every fourth member is std140 array wrapper
+SyntheticShader makeShader(int uniformCount) {
+  SyntheticShader shader;
+  shader.Buffer.TypeName = "GlobalParams_0";
+  shader.Buffer.Name = "globalParams_0";
+
+  std::string members;
+  std::string body;
+  for (int i = 0; i < uniformCount; i++) {
+    auto name = "u_param" + std::to_string(i) + "_v";
+    bool isStruct = i % 4 == 3;
+    shader.Buffer.Members.push_back({name, isStruct});
+    if (isStruct) {
+      shader.Buffer.Declarations += "uniform vec4 " + name + "[4];\n";
+      members += "    _Array_std140_vector_float_4_4 " + name + ";\n";
+    } else {
+      shader.Buffer.Declarations += "uniform vec4 " + name + ";\n";
+      members += "    vec4 " + name + ";\n";
+    }
+
+    for (int j = 0; j < usesPerUniform; j++) {
+      if (isStruct) {
+        body += "    acc += globalParams_0." + name + ".data[" + std::to_string(j) + "] * 0.5;\n";
+      } else {
+        body += "    acc += globalParams_0." + name + " * vec4(1.0e-2, 2.0, 3.0, 4.0);\n";
+      }
+    }
+  }
+
+  shader.Source = "#version 150\nstruct _Array_std140_vector_float_4_4\n{\n    vec4 data[4];\n};\n\nstruct GlobalParams_0\n{\n" + members +
+                  "};\n\nuniform GlobalParams_0 globalParams_0;\n\nout vec4 entryPointParam_fragmentMain;\n\nvoid main()\n{\n" +
+                  "    vec4 acc = vec4(0.0);\n" + body + "    entryPointParam_fragmentMain = acc;\n}\n";
+  return shader;
+}
+
+// previous implementation, one regex pass over the whole source per member
+std::string rewriteWithRegex(std::string source, const BgfxSlang::UniformBufferRewrite &buffer) {
+  for (const auto &member : buffer.Members) {
+    if (member.IsStruct) {
+      source = std::regex_replace(source, std::regex(buffer.Name + "\\." + member.Name + "\\.data"), buffer.Name + "." + member.Name);
+    }
+    source = std::regex_replace(source, std::regex(buffer.Name + "\\." + member.Name + "(?![A-Za-z])"), member.Name);
+  }
+  return std::regex_replace(source, std::regex("uniform " + buffer.TypeName + " " + buffer.Name + ";\n"), buffer.Declarations);
+}
+} // namespace
+
+void runGlslRewriteBench(JsonWriter &json) {
+  json.BeginArray("results");
+  for (int uniformCount = 8; uniformCount <= 1024; uniformCount *= 2) {
+    auto shader = makeShader(uniformCount);
+    std::vector<BgfxSlang::UniformBufferRewrite> buffers = {shader.Buffer};
+
+    std::string tokenResult;
+    auto tokenNs = measureNs(iterations, [&]() { tokenResult = BgfxSlang::rewriteUniformBuffers(shader.Source, buffers); });
+
+    json.BeginObject();
+    json.Value("uniforms", uniformCount);
+    json.Value("sourceBytes", static_cast<uint64_t>(shader.Source.size()));
+    json.Value("tokenRewriterNs", tokenNs);
+    json.Value("tokenRewriterNsPerByte", static_cast<double>(tokenNs) / static_cast<double>(shader.Source.size()));
+
+    if (uniformCount <= regexMaxUniforms) {
+      std::string regexResult;
+      auto regexNs = measureNs(iterations, [&]() { regexResult = rewriteWithRegex(shader.Source, shader.Buffer); });
+      json.Value("regexNs", regexNs);
+      json.Value("sameOutput", regexResult == tokenResult);
+    }
+    json.EndObject();
+  }
+  json.EndArray();
+}
+
+} // namespace BgfxSlangBench
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlangBench {
+
+// Minimal streaming JSON writer, enough for benchmark reports.
+class JsonWriter {
+public:
+  explicit JsonWriter(std::ostream &out) : out(out) {}
+
+  void BeginObject(std::string_view key = {}) { begin(key, '{'); }
+  void EndObject() { end('}'); }
+  void BeginArray(std::string_view key = {}) { begin(key, '['); }
+  void EndArray() { end(']'); }
+
+  void Value(std::string_view key, std::string_view value) {
+    writeKey(key);
+    writeString(value);
+  }
+  void Value(std::string_view key, const char *value) { Value(key, std::string_view{value}); }
+  void Value(std::string_view key, uint64_t value) {
+    writeKey(key);
+    out << value;
+  }
+  void Value(std::string_view key, int64_t value) {
+    writeKey(key);
+    out << value;
+  }
+  void Value(std::string_view key, int value) { Value(key, static_cast<int64_t>(value)); }
+  void Value(std::string_view key, double value) {
+    writeKey(key);
+    out << value;
+  }
+  void Value(std::string_view key, bool value) {
+    writeKey(key);
+    out << (value ? "true" : "false");
+  }
+
+private:
+  std::ostream &out;
+  std::vector<bool> hasItems;
+
+  void begin(std::string_view key, char bracket) {
+    writeKey(key);
+    out << bracket;
+    hasItems.push_back(false);
+  }
+
+  void end(char bracket) {
+    hasItems.pop_back();
+    out << bracket;
+    if (hasItems.empty()) {
+      out << '\n';
+    }
+  }
+
+  void writeKey(std::string_view key) {
+    if (!hasItems.empty()) {
+      if (hasItems.back()) {
+        out << ',';
+      }
+      hasItems.back() = true;
+    }
+    if (!key.empty()) {
+      writeString(key);
+      out << ':';
+    }
+  }
+
+  void writeString(std::string_view value) {
+    out << '"';
+    for (const auto c : value) {
+      if (c == '"' || c == '\\') {
+        out << '\\' << c;
+      } else if (c == '\n') {
+        out << "\\n";
+      } else {
+        out << c;
+      }
+    }
+    out << '"';
+  }
+};
+
+} // namespace BgfxSlangBench
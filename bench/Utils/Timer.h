@@ -0,0 +1,25 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace BgfxSlangBench {
+
+// Median wall time of the function in nanoseconds.
+template <typename TFunc>
+uint64_t measureNs(int iterations, TFunc &&func) {
+  std::vector<uint64_t> samples;
+  samples.reserve(iterations);
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+} // namespace BgfxSlangBench
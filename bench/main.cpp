@@ -0,0 +1,42 @@
+#include "Benchmarks.h"
+#include "Utils/JsonWriter.h"
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+struct Suite {
+  std::string_view Name;
+  std::function<void(BgfxSlangBench::JsonWriter &)> Run;
+};
+
+// Usage: bgfx-slang-bench [suite...]. Runs all suites when none is given, the report is written to stdout as JSON.
+int main(int argc, char **argv) {
+  const Suite suites[] = {
+      {"glsl-rewrite", BgfxSlangBench::runGlslRewriteBench},
+      {"bin2c", BgfxSlangBench::runBin2cBench},
+      {"compile", BgfxSlangBench::runCompileBench},
+  };
+
+  BgfxSlangBench::JsonWriter json(std::cout);
+  json.BeginObject();
+  json.BeginArray("suites");
+
+  for (const auto &suite : suites) {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc; i++) {
+      selected |= suite.Name == argv[i];
+    }
+    if (!selected) {
+      continue;
+    }
+
+    json.BeginObject();
+    json.Value("name", suite.Name);
+    suite.Run(json);
+    json.EndObject();
+  }
+
+  json.EndArray();
+  json.EndObject();
+  return 0;
+}
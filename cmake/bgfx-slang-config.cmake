@@ -1,6 +1,8 @@
 include(CMakeFindDependencyMacro)
 find_dependency(spirv_cross_core CONFIG REQUIRED)
 find_dependency(spirv_cross_glsl CONFIG REQUIRED)
+# only needed when the library was built with BGFXSLANG_ZSTD
+find_package(zstd CONFIG QUIET)
 
 include(${CMAKE_CURRENT_LIST_DIR}/bgfx-slang-targets.cmake)
 include(${CMAKE_CURRENT_LIST_DIR}/bgfx-slang-toolUtils.cmake)
\ No newline at end of file
@@ -14,8 +14,8 @@ function(_bgfx_slang_get_target_header_var_name TARGET TARGET_VAR_NAME)
 endfunction()
 
 function(bgfx_slang_compile_shaders)
-  set(options AS_HEADERS VERBOSE)
-  set(oneValueArgs OUTPUT_DIR OUTPUT_PATTERN OUT_FILES_VAR HEADER_VAR_PATTERN)
+  set(options AS_HEADERS VERBOSE BATCH)
+  set(oneValueArgs OUTPUT_DIR OUTPUT_PATTERN OUT_FILES_VAR HEADER_VAR_PATTERN HEADER_FORMAT CACHE_DIR JOBS PACK PACK_TAG PACK_COMPRESSION)
   set(multiValueArgs TYPES INPUT_SHADERS INCLUDE_DIRS)
   cmake_parse_arguments(ARGS "${options}" "${oneValueArgs}" "${multiValueArgs}" "${ARGN}")
 
@@ -28,7 +28,13 @@ function(bgfx_slang_compile_shaders)
     NAMES bgfx-slang-cmd
   )
 
+  # the pack is written by single tool invocation compiling all the shaders
+  if (ARGS_PACK)
+    set(ARGS_BATCH TRUE)
+  endif()
+
   set(ALL_OUTPUTS "")
+  set(BATCH_INPUTS "")
   foreach(INPUT_SHADER_FILE ${ARGS_INPUT_SHADERS})
     source_group("Shaders" FILES ${INPUT_SHADER_FILE})
     get_filename_component(SHADER_FILE_NAME_WE ${INPUT_SHADER_FILE} NAME_WE)
@@ -41,19 +47,26 @@ function(bgfx_slang_compile_shaders)
       set(HEADER_SUFFIX .h)
       if (ARGS_HEADER_VAR_PATTERN)
         list(APPEND CLI "-b" "${ARGS_HEADER_VAR_PATTERN}")
+      elseif (ARGS_PACK)
+        # single variable named after the pack file
+        list(APPEND CLI "-b" "{{name}}")
       else()
         list(APPEND CLI "-b" "{{stage}}_{{name}}_{{target}}")
       endif()
+      if (ARGS_HEADER_FORMAT)
+        list(APPEND CLI "--bin2c-format" "${ARGS_HEADER_FORMAT}")
+      endif()
     endif()
 
     if (ARGS_OUTPUT_PATTERN)
       set(OUTPUT_PATTERN ${ARGS_OUTPUT_DIR}/${ARGS_OUTPUT_PATTERN}${HEADER_SUFFIX})
+    elseif (ARGS_BATCH)
+      # the same pattern is used for all the inputs, so the file name is resolved by the tool
+      set(OUTPUT_PATTERN ${ARGS_OUTPUT_DIR}/{{target}}/{{stage}}_{{filename}}.bin${HEADER_SUFFIX})
     else()
       set(OUTPUT_PATTERN ${ARGS_OUTPUT_DIR}/{{target}}/{{stage}}_${SHADER_FILE_BASENAME}.bin${HEADER_SUFFIX})
     endif()
-    
-    # input shader
-    list(APPEND CLI "${INPUT_SHADER_FILE}")
+
     list(APPEND CLI "-o" "${OUTPUT_PATTERN}")
     
     set(OUTPUTS "")
@@ -78,10 +91,16 @@ function(bgfx_slang_compile_shaders)
       string(REPLACE {{target}} ${TARGET_PATH_NAME} TARGET_OUTPUT_PATH ${OUTPUT_PATTERN})
       string(REPLACE {{name}} ${SHADER_FILE_NAME_WE} TARGET_OUTPUT_PATH ${TARGET_OUTPUT_PATH})
       string(REPLACE {{fileName}} ${SHADER_FILE_BASENAME} TARGET_OUTPUT_PATH ${TARGET_OUTPUT_PATH})
+      string(REPLACE {{filename}} ${SHADER_FILE_BASENAME} TARGET_OUTPUT_PATH ${TARGET_OUTPUT_PATH})
       list(APPEND CLI "-t" "${TARGET}")
       foreach(STAGE ${STAGES})
         string(REPLACE {{stage}} ${STAGE} STAGE_OUTPUT_PATH ${TARGET_OUTPUT_PATH})
         list(APPEND OUTPUTS ${STAGE_OUTPUT_PATH})
+        # embedded binary data is written next to the header, without the .h extension
+        if (ARGS_AS_HEADERS AND ARGS_HEADER_FORMAT STREQUAL "embed")
+          string(REGEX REPLACE "\\.h$" "" STAGE_DATA_PATH ${STAGE_OUTPUT_PATH})
+          list(APPEND OUTPUTS ${STAGE_DATA_PATH})
+        endif()
       endforeach()
     endforeach()
 
@@ -96,15 +115,65 @@ function(bgfx_slang_compile_shaders)
       list(APPEND CLI "-v")
     endif()
 
+    if (ARGS_CACHE_DIR)
+      list(APPEND CLI "--cache-dir" "${ARGS_CACHE_DIR}")
+    endif()
+
     list(APPEND ALL_OUTPUTS ${OUTPUTS})
 
+    if (ARGS_BATCH)
+      list(APPEND BATCH_INPUTS ${SHADER_FILE_ABSOLUTE})
+      continue()
+    endif()
+
+    # imported modules and included files are listed in the depfile written by the tool
+    string(MD5 SHADER_HASH "${SHADER_FILE_ABSOLUTE}${ARGS_OUTPUT_DIR}")
+    set(SHADER_DEPFILE ${CMAKE_CURRENT_BINARY_DIR}/bgfx-slang-${SHADER_FILE_NAME_WE}-${SHADER_HASH}.d)
+
     add_custom_command(
       OUTPUT ${OUTPUTS}
-      COMMAND ${BGFX_SLANG_CMD_EXECUTABLE} ${CLI}
+      COMMAND ${BGFX_SLANG_CMD_EXECUTABLE} ${INPUT_SHADER_FILE} ${CLI} --depfile ${SHADER_DEPFILE}
       MAIN_DEPENDENCY ${SHADER_FILE_ABSOLUTE}
+      DEPFILE ${SHADER_DEPFILE}
     )
   endforeach()
 
+  # all the shaders compiled by one process, the inputs are passed through a response file
+  if (ARGS_BATCH AND BATCH_INPUTS)
+    if (NOT DEFINED ARGS_JOBS)
+      set(ARGS_JOBS 0)
+    endif()
+
+    if (ARGS_PACK)
+      set(ALL_OUTPUTS ${ARGS_PACK})
+      if (ARGS_AS_HEADERS AND ARGS_HEADER_FORMAT STREQUAL "embed")
+        string(REGEX REPLACE "\\.h$" "" PACK_DATA_PATH ${ARGS_PACK})
+        list(APPEND ALL_OUTPUTS ${PACK_DATA_PATH})
+      endif()
+      list(APPEND CLI "--pack" "${ARGS_PACK}")
+      if (ARGS_PACK_TAG)
+        list(APPEND CLI "--pack-tag" "${ARGS_PACK_TAG}")
+      endif()
+      if (ARGS_PACK_COMPRESSION)
+        list(APPEND CLI "--pack-compression" "${ARGS_PACK_COMPRESSION}")
+      endif()
+    endif()
+
+    string(MD5 BATCH_HASH "${BATCH_INPUTS}${ARGS_OUTPUT_DIR}${ARGS_PACK}")
+    set(BATCH_RESPONSE_FILE ${CMAKE_CURRENT_BINARY_DIR}/bgfx-slang-${BATCH_HASH}.rsp)
+    list(JOIN BATCH_INPUTS "\n" BATCH_RESPONSE_CONTENT)
+    file(CONFIGURE OUTPUT ${BATCH_RESPONSE_FILE} CONTENT "${BATCH_RESPONSE_CONTENT}\n" @ONLY)
+
+    set(BATCH_DEPFILE ${CMAKE_CURRENT_BINARY_DIR}/bgfx-slang-${BATCH_HASH}.d)
+
+    add_custom_command(
+      OUTPUT ${ALL_OUTPUTS}
+      COMMAND ${BGFX_SLANG_CMD_EXECUTABLE} @${BATCH_RESPONSE_FILE} ${CLI} -j ${ARGS_JOBS} --depfile ${BATCH_DEPFILE}
+      DEPENDS ${BATCH_INPUTS} ${BATCH_RESPONSE_FILE}
+      DEPFILE ${BATCH_DEPFILE}
+    )
+  endif()
+
   if(DEFINED ARGS_OUT_FILES_VAR)
     set(${ARGS_OUT_FILES_VAR} ${ALL_OUTPUTS} PARENT_SCOPE)
   endif()
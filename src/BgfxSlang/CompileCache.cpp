@@ -0,0 +1,115 @@
+#include "CompileCache.h"
+#include "Utils/Hash.h"
+#include "Utils/TempPath.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace BgfxSlang {
+
+namespace {
+constexpr uint32_t cacheMagic = 0x31435342; // "BSC1"
+
+template <typename T>
+bool read(std::ifstream &file, T &value) {
+  file.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return file.good();
+}
+
+template <typename T>
+void write(std::ofstream &file, const T &value) {
+  file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+} // namespace
+
+std::filesystem::path CompileCache::GetDefaultDirectory() {
+  if (const char *xdgCache = std::getenv("XDG_CACHE_HOME"); xdgCache != nullptr && *xdgCache != '\0') {
+    return std::filesystem::path{xdgCache} / "bgfx-slang";
+  }
+#ifdef _WIN32
+  if (const char *localAppData = std::getenv("LOCALAPPDATA"); localAppData != nullptr && *localAppData != '\0') {
+    return std::filesystem::path{localAppData} / "bgfx-slang";
+  }
+#endif
+  if (const char *home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+    return std::filesystem::path{home} / ".cache" / "bgfx-slang";
+  }
+  return std::filesystem::temp_directory_path() / "bgfx-slang";
+}
+
+std::filesystem::path CompileCache::getEntryPath(std::string_view key) const {
+  return directory / std::format("{:016x}.bin", fnv1a64(key));
+}
+
+bool CompileCache::Load(std::string_view key, std::vector<uint8_t> &outData) const {
+  std::ifstream file(getEntryPath(key), std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  uint32_t magic = 0;
+  uint32_t keySize = 0;
+  if (!read(file, magic) || magic != cacheMagic || !read(file, keySize) || keySize != key.size()) {
+    return false;
+  }
+
+  std::string storedKey(keySize, '\0');
+  file.read(storedKey.data(), keySize);
+  if (!file.good() || storedKey != key) {
+    return false;
+  }
+
+  uint64_t dataSize = 0;
+  if (!read(file, dataSize)) {
+    return false;
+  }
+
+  outData.resize(dataSize);
+  file.read(reinterpret_cast<char *>(outData.data()), static_cast<std::streamsize>(dataSize));
+  return static_cast<uint64_t>(file.gcount()) == dataSize;
+}
+
+bool CompileCache::Store(std::string_view key, std::span<const uint8_t> data) const {
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+
+  // written next to the final entry and renamed, so concurrent readers never see a partial file
+  const auto path = getEntryPath(key);
+  const auto tmpPath = makeTempPath(path);
+
+  {
+    std::ofstream file(tmpPath, std::ios::binary);
+    if (!file.is_open()) {
+      return false;
+    }
+
+    write(file, cacheMagic);
+    write(file, static_cast<uint32_t>(key.size()));
+    file.write(key.data(), static_cast<std::streamsize>(key.size()));
+    write(file, static_cast<uint64_t>(data.size()));
+    file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file.good()) {
+      file.close();
+      std::filesystem::remove(tmpPath, error);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tmpPath, path, error);
+  if (error) {
+    std::filesystem::remove(tmpPath, error);
+    return false;
+  }
+  return true;
+}
+
+} // namespace BgfxSlang
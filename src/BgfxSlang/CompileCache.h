@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace BgfxSlang {
+
+// On-disk store of compiled bgfx shader blobs. Every entry is a single file named after the hash of its key.
+// The full key is stored in the file as well, so hash collisions are detected on load.
+class CompileCache {
+public:
+  explicit CompileCache(std::filesystem::path directory) : directory(std::move(directory)) {}
+
+  [[nodiscard]] const std::filesystem::path &GetDirectory() const { return directory; }
+
+  bool Load(std::string_view key, std::vector<uint8_t> &outData) const;
+  bool Store(std::string_view key, std::span<const uint8_t> data) const;
+
+  // $XDG_CACHE_HOME/bgfx-slang, falling back to ~/.cache/bgfx-slang (%LOCALAPPDATA%/bgfx-slang on Windows)
+  static std::filesystem::path GetDefaultDirectory();
+
+private:
+  std::filesystem::path directory;
+
+  [[nodiscard]] std::filesystem::path getEntryPath(std::string_view key) const;
+};
+
+} // namespace BgfxSlang
@@ -2,23 +2,40 @@
 #include "Attributes.h"
 #include "EntryPoint.h"
 #include "Glsl.h"
+#include "SpirvPasses.h"
 #include "Status.h"
 #include "Target.h"
 #include "TextureData.h"
 #include "Types.h"
+#include "Utils/BufferWriter.h"
+#include "Utils/Hash.h"
 #include "Utils/IWriter.h"
+#include "Utils/MemoryBlob.h"
 #include "Utils/StringUtils.h"
+#include "Utils/Trace.h"
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <slang-com-ptr.h>
 #include <slang.h>
 #include <span>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace BgfxSlang {
@@ -30,12 +47,34 @@ constexpr uint32_t shift3Bytes = 24;
 
 constexpr uint8_t kUniformFragmentBit = 0x10;
 constexpr uint8_t kUniformReadOnlyBit = 0x40;
+constexpr uint8_t kUniformTypeMask = 0x0f;
 
 constexpr uint16_t storageBufferDesrcriptor = 0x0007;
 constexpr uint16_t storageImageDescriptor = 0x0003;
 
 constexpr uint8_t version = 11;
 
+// bumped whenever the generated output changes for the same slang code, invalidates the compile cache entries
+constexpr uint32_t cacheVersion = 2;
+
+// commit the library was configured from, so development builds don't reuse entries of older codegen
+#ifdef BGFXSLANG_BUILD_ID
+constexpr std::string_view buildId = BGFXSLANG_BUILD_ID;
+#else
+constexpr std::string_view buildId = "unknown";
+#endif
+
+constexpr std::string_view mainModuleName = "sh";
+// modules of the programs loaded by UpdateProgram get the version appended, the earlier versions stay in the sessions
+constexpr std::string_view updatedModulePrefix = "sh__v";
+constexpr std::string_view moduleExtension = ".slang";
+
+bool isProgramModuleName(std::string_view name) { return name == mainModuleName || name.starts_with(updatedModulePrefix); }
+
+bool isProgramModulePath(std::string_view path) {
+  return path.ends_with(moduleExtension) && isProgramModuleName(path.substr(0, path.size() - moduleExtension.size()));
+}
+
 constexpr uint32_t composeMagic(char a, char b, char c, uint8_t ver) {
   return (static_cast<uint32_t>(a)) | (static_cast<uint32_t>(b) << shift1Byte) | (static_cast<uint32_t>(c) << shift2Bytes) |
          static_cast<uint32_t>(ver) << shift3Bytes;
@@ -140,15 +179,52 @@ Status getOutputParams(slang::EntryPointReflection *entryPoint, std::vector<Para
   return processInOutParams(resultVarLayout, params);
 }
 
-uint32_t hashParams(const std::vector<Param> &params) {
-  uint32_t hash = 0;
-  std::vector<std::string> names(params.size());
+// Fields of the shader blob gathered on the stack, so the writer gets a single call for them.
+template <size_t Capacity> class PackedRecord {
+public:
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  void Append(const T &value) {
+    Append(&value, sizeof(T));
+  }
 
-  std::transform(params.begin(), params.end(), names.begin(), [](const Param &p) { return p.Name; });
-  std::sort(names.begin(), names.end());
-  std::hash<std::string> hasher;
-  for (const auto &name : names) {
-    hash ^= hasher(name);
+  void Append(const void *data, size_t count) {
+    std::memcpy(bytes.data() + size, data, count);
+    size += count;
+  }
+
+  void WriteTo(IWriter &writer) const { writer.Write(bytes.data(), size); }
+
+private:
+  std::array<uint8_t, Capacity> bytes;
+  size_t size = 0;
+};
+
+// name size, type, count, register index and count, texture component, dimension and format
+constexpr size_t uniformFieldsSize = sizeof(uint8_t) + sizeof(uint8_t) + sizeof(Uniform::Count) + sizeof(Uniform::RegIndex) +
+                                     sizeof(Uniform::RegCount) + sizeof(Uniform::TexComponent) + sizeof(Uniform::TexDimension) +
+                                     sizeof(Uniform::TexFormat);
+constexpr size_t maxUniformNameSize = std::numeric_limits<uint8_t>::max();
+// magic, input and output hashes, uniform count
+constexpr size_t headerFieldsSize = sizeof(uint32_t) * 3 + sizeof(uint16_t);
+
+inline size_t getUniformNameSize(const Uniform &uniform) { return std::min(uniform.Name.size(), maxUniformNameSize); }
+
+// Hash of the vertex shader outputs and fragment shader inputs, bgfx checks that the shaders of a program have the same. FNV-1a of
+// the names and semantics sorted by name, so it doesn't depend on the declaration order, the host or the standard library.
+uint32_t hashParams(const std::vector<Param> &params) {
+  std::vector<const Param *> sorted(params.size());
+  std::transform(params.begin(), params.end(), sorted.begin(), [](const Param &p) { return &p; });
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Param *a, const Param *b) { return std::tie(a->Name, a->Attr) < std::tie(b->Name, b->Attr); });
+
+  uint32_t hash = fnv1a32Offset;
+  for (const auto *param : sorted) {
+    // the terminators keep the boundaries, so "ab" + "c" doesn't hash as "a" + "bc"
+    hash = fnv1a32(param->Name, hash);
+    hash = fnv1a32(std::string_view{"\0", 1}, hash);
+    hash = fnv1a32(attribToString(param->Attr), hash);
+    hash = fnv1a32(std::string_view{"\0", 1}, hash);
   }
   return hash;
 }
@@ -212,8 +288,99 @@ Status verifyUniformLayout(slang::TypeLayoutReflection *scopeTypeLayout, slang::
   return Status{};
 }
 
+// float, float2 and float3 globals outside arrays, bgfx has no uniform types for them
+bool isPackableUniform(slang::TypeReflection *type) {
+  const auto kind = type->getKind();
+  return (kind == slang::TypeReflection::Kind::Scalar ||
+          (kind == slang::TypeReflection::Kind::Vector && type->getElementCount() < uniformRegisterComponents)) &&
+         type->getScalarType() == slang::TypeReflection::ScalarType::Float32;
+}
+
+Status packProgramUniforms(slang::ProgramLayout *programLayout, std::string_view name, UniformPacking &outPacking) {
+  outPacking = {};
+  if (name.empty()) {
+    return Status{};
+  }
+
+  auto *globalVarLayout = programLayout->getGlobalParamsVarLayout();
+  slang::VariableLayoutReflection *elementsVarLayout = globalVarLayout;
+  slang::TypeLayoutReflection *elementsTypeLayout;
+  if (auto status = verifyUniformLayout(globalVarLayout->getTypeLayout(), elementsVarLayout, elementsTypeLayout); !status.IsOk()) {
+    return status;
+  }
+
+  std::vector<UniformToPack> uniforms;
+  for (int i = 0; i < elementsTypeLayout->getFieldCount(); i++) {
+    auto *field = elementsTypeLayout->getFieldByIndex(i);
+    auto *type = field->getType();
+    if (field->getName() == name) {
+      return Status{StatusCode::Error, "Packed uniform name is used by a uniform: " + std::string(name)};
+    }
+    if (isPackableUniform(type)) {
+      const auto componentCount = type->getKind() == slang::TypeReflection::Kind::Scalar ? 1 : type->getElementCount();
+      uniforms.push_back({field->getName(), static_cast<uint8_t>(componentCount)});
+    }
+  }
+
+  outPacking = packUniforms(name, uniforms);
+  if (outPacking.RegisterCount > std::numeric_limits<uint8_t>::max()) {
+    outPacking = {};
+    return Status{StatusCode::Error, "Packed uniforms need more than 255 registers"};
+  }
+  return Status{};
+}
+
+// Global uniform buffer laid out again for the packed uniforms or the compaction: the used members in declaration order, each from a
+// new register, then the packed registers. With usedFields (per field of the buffer) the members the shader doesn't read are moved
+// past the returned size, they stay in the SPIR-V struct and must not overlap the others. Returns the size of the used members.
+uint32_t layoutUniformBuffer(slang::TypeLayoutReflection *elementsTypeLayout, const UniformPacking &packing,
+                             const std::vector<bool> &usedFields, std::vector<std::pair<std::string, uint32_t>> &outMemberOffsets) {
+  constexpr uint32_t registerSize = uniformRegisterComponents * sizeof(float);
+  const auto isUsed = [&](int fieldIdx) { return usedFields.empty() || usedFields[fieldIdx]; };
+
+  bool usesPackedUniforms = false;
+  for (int i = 0; i < elementsTypeLayout->getFieldCount(); i++) {
+    usesPackedUniforms |= isUsed(i) && packing.Find(elementsTypeLayout->getFieldByIndex(i)->getName()) != nullptr;
+  }
+
+  uint32_t size = 0;
+  const auto addMembers = [&](bool used) {
+    for (int i = 0; i < elementsTypeLayout->getFieldCount(); i++) {
+      auto *field = elementsTypeLayout->getFieldByIndex(i);
+      // resources have no uniform data
+      const auto fieldSize = static_cast<uint32_t>(field->getTypeLayout()->getSize());
+      if (fieldSize == 0 || isUsed(i) != used || packing.Find(field->getName()) != nullptr) {
+        continue;
+      }
+      outMemberOffsets.emplace_back(field->getName(), size);
+      size += (fieldSize + registerSize - 1) / registerSize * registerSize;
+    }
+  };
+  const auto addPackedRegisters = [&] {
+    for (const auto &field : packing.Fields) {
+      outMemberOffsets.emplace_back(field.Name, size + field.GetFloatIndex() * sizeof(float));
+    }
+    size += packing.RegisterCount * registerSize;
+  };
+
+  addMembers(true);
+  if (usesPackedUniforms) {
+    addPackedRegisters();
+  }
+  const uint32_t usedSize = size;
+  addMembers(false);
+  if (!usesPackedUniforms) {
+    addPackedRegisters();
+  }
+  return usedSize;
+}
+
+// compacts - the buffer has only the used members, usedMembers - names of the members the code reads, nullptr when only the slang
+// metadata is known
 Status getUniforms(slang::ProgramLayout *programLayout, slang::IMetadata *entryPointMetadata, TargetProfile target, SlangStage stage,
-                   std::vector<Uniform> &uniforms, uint16_t &uniformBufferSize) {
+                   const UniformPacking &packing, bool compacts, const std::vector<std::string> *usedMembers,
+                   std::vector<Uniform> &uniforms, uint16_t &uniformBufferSize,
+                   std::vector<std::pair<std::string, uint32_t>> &outMemberOffsets) {
   auto *globalVarLayout = programLayout->getGlobalParamsVarLayout();
   auto *scopeTypeLayout = globalVarLayout->getTypeLayout();
 
@@ -224,6 +391,20 @@ Status getUniforms(slang::ProgramLayout *programLayout, slang::IMetadata *entryP
     return status;
   }
 
+  // DirectX bytecode can't be changed, the packing and the compaction need a new layout of the uniform buffer
+  const bool isRelaidOut = (!packing.IsEmpty() || compacts) && target.Format != TargetFormat::DirectX;
+  std::vector<bool> usedFields;
+  if (compacts && isRelaidOut) {
+    for (int i = 0; i < elementsTypeLayout->getFieldCount(); i++) {
+      auto *field = elementsTypeLayout->getFieldByIndex(i);
+      const bool isData = field->getTypeLayout()->getSize() > 0;
+      usedFields.push_back(isUsedUniform(entryPointMetadata, target, stage, field) &&
+                           (!isData || usedMembers == nullptr || std::ranges::binary_search(*usedMembers, field->getName())));
+    }
+  }
+  const uint32_t bufferSize = isRelaidOut ? layoutUniformBuffer(elementsTypeLayout, packing, usedFields, outMemberOffsets) : 0;
+  bool usesPackedUniforms = false;
+
   uint64_t textureIndex = 0;
   for (int i = 0; i < elementsTypeLayout->getFieldCount(); i++) {
     auto *param = elementsTypeLayout->getFieldByIndex(i);
@@ -234,7 +415,7 @@ Status getUniforms(slang::ProgramLayout *programLayout, slang::IMetadata *entryP
 
     auto *elementType = isArray ? paramType->getElementType() : paramType;
 
-    if (!isUsedUniform(entryPointMetadata, target, stage, param)) {
+    if (!usedFields.empty() ? !usedFields[i] : !isUsedUniform(entryPointMetadata, target, stage, param)) {
       continue;
     }
 
@@ -242,6 +423,14 @@ Status getUniforms(slang::ProgramLayout *programLayout, slang::IMetadata *entryP
       continue;
     }
 
+    if (packing.Find(param->getName()) != nullptr) {
+      if (!isRelaidOut) {
+        return Status{StatusCode::Error, "Uniform packing is not supported for DirectX targets, used by " + std::string(param->getName())};
+      }
+      usesPackedUniforms = true;
+      continue;
+    }
+
     auto isCompute = stage == SLANG_STAGE_COMPUTE;
 
     auto convertedType = convertUniformType(elementType, isCompute);
@@ -268,7 +457,8 @@ Status getUniforms(slang::ProgramLayout *programLayout, slang::IMetadata *entryP
       uniform.RegIndex = param->getBindingIndex();
       uniform.RegCount = storageImageDescriptor;
     } else {
-      uniform.RegIndex = param->getOffset();
+      auto offsetIt = std::ranges::find(outMemberOffsets, uniform.Name, &std::pair<std::string, uint32_t>::first);
+      uniform.RegIndex = offsetIt != outMemberOffsets.end() ? offsetIt->second : param->getOffset();
       uniform.RegCount = elementType->getRowCount() * uniform.Count;
     }
 
@@ -281,26 +471,186 @@ Status getUniforms(slang::ProgramLayout *programLayout, slang::IMetadata *entryP
     uniforms.push_back(uniform);
   }
 
-  uniformBufferSize = static_cast<uint16_t>(elementsTypeLayout->getSize());
+  if (usesPackedUniforms) {
+    Uniform uniform;
+    uniform.Name = packing.Name;
+    uniform.Type = UniformType::Vec4;
+    uniform.Count = static_cast<uint8_t>(packing.RegisterCount);
+    // the packed registers end the used members
+    uniform.RegIndex = bufferSize - packing.RegisterCount * uniformRegisterComponents * sizeof(float);
+    uniform.RegCount = packing.RegisterCount;
+    uniforms.push_back(uniform);
+  }
+
+  uniformBufferSize = static_cast<uint16_t>(isRelaidOut ? bufferSize : elementsTypeLayout->getSize());
   return Status{};
 }
 
+// Results with byte-identical data point to the first of them, their data is released.
+void markDuplicates(std::vector<CompileResult> &results) {
+  std::unordered_multimap<uint64_t, size_t> resultsByHash;
+  for (size_t i = 0; i < results.size(); i++) {
+    auto &result = results[i];
+    if (result.Result.IsError() || result.Data.empty()) {
+      continue;
+    }
+
+    const auto hash = fnv1a64(std::string_view{reinterpret_cast<const char *>(result.Data.data()), result.Data.size()});
+    auto [first, last] = resultsByHash.equal_range(hash);
+    auto it = std::find_if(first, last, [&](const auto &entry) { return results[entry.second].Data == result.Data; });
+    if (it == last) {
+      resultsByHash.emplace(hash, i);
+      continue;
+    }
+
+    result.DuplicateOf = static_cast<int64_t>(it->second);
+    result.Data = {};
+  }
+}
+
 } // namespace
 
+bool readShaderReflection(std::span<const uint8_t> blob, TargetFormat format, ShaderReflection &reflection) {
+  size_t offset = 0;
+  auto read = [&](auto &value) {
+    if (blob.size() - offset < sizeof(value)) {
+      return false;
+    }
+    std::memcpy(&value, blob.data() + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+  };
+
+  uint32_t magic = 0;
+  uint16_t uniformCount = 0;
+  if (!read(magic) || !read(reflection.InputHash) || !read(reflection.OutputHash) || !read(uniformCount)) {
+    return false;
+  }
+  reflection.Stage = magic == magicVsh ? StageType::Vertex
+                     : magic == magicFsh ? StageType::Fragment
+                     : magic == magicCsh ? StageType::Compute
+                                         : StageType::Unknown;
+
+  reflection.Uniforms.resize(uniformCount);
+  for (auto &uniform : reflection.Uniforms) {
+    uint8_t nameSize = 0;
+    uint8_t type = 0;
+    if (!read(nameSize) || blob.size() - offset < nameSize) {
+      return false;
+    }
+    uniform.Name.assign(reinterpret_cast<const char *>(blob.data() + offset), nameSize);
+    offset += nameSize;
+    if (!read(type) || !read(uniform.Count) || !read(uniform.RegIndex) || !read(uniform.RegCount) || !read(uniform.TexComponent) ||
+        !read(uniform.TexDimension) || !read(uniform.TexFormat)) {
+      return false;
+    }
+    uniform.Type = static_cast<UniformType>(type & kUniformTypeMask);
+  }
+
+  reflection.Attributes.clear();
+  if (reflection.Stage != StageType::Vertex || format == TargetFormat::Unknown) {
+    return true;
+  }
+  uint32_t codeSize = 0;
+  if (!read(codeSize) || blob.size() - offset < codeSize) {
+    return false;
+  }
+  const std::string_view code{reinterpret_cast<const char *>(blob.data() + offset), codeSize};
+  offset += codeSize;
+
+  // GLSL shaders have no attribute list, bgfx finds the attributes by their names in the code
+  if (format == TargetFormat::OpenGL || format == TargetFormat::OpenGLES) {
+    reflection.Attributes = findGlslVertexAttributes(code);
+    return true;
+  }
+
+  uint8_t nul = 0;
+  uint8_t attributeCount = 0;
+  if (!read(nul) || !read(attributeCount)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < attributeCount; i++) {
+    uint16_t id = 0;
+    if (!read(id)) {
+      return false;
+    }
+    // instance data is marked with invalid id
+    const auto attribute = std::ranges::find(attribToIdMap, id, &AttribToId::Id);
+    if (attribute != attribToIdMap.end()) {
+      reflection.Attributes.push_back(attribute->Attr);
+    }
+  }
+  return true;
+}
+
+Compiler::~Compiler() {
+  if (globalSessionPool == nullptr) {
+    return;
+  }
+  // released before the global session is handed to other compilers
+  linkedEntryPoints.clear();
+  loadedModule = nullptr;
+  loadSession = nullptr;
+  for (auto &context : contexts) {
+    context->Sessions.clear();
+    globalSessionPool->Release(std::move(context->GlobalSession));
+  }
+}
+
 Status Compiler::AddTarget(std::string_view profile, std::span<slang::CompilerOptionEntry> additionalCompilerOptions) {
+  return AddTarget(profile, TargetOptimization{}, additionalCompilerOptions);
+}
+
+Status Compiler::AddTarget(std::string_view profile, TargetOptimization optimization,
+                           std::span<slang::CompilerOptionEntry> additionalCompilerOptions) {
   auto target = findProfile(profile);
   if (target.Format == TargetFormat::Unknown) {
     return Status{StatusCode::Error, "Unknown target profile: " + std::string(profile)};
   }
+  if (optimization.Level == OptimizationLevel::Unknown) {
+    return Status{StatusCode::Error, "Unknown optimization level for target: " + std::string(profile)};
+  }
 
   TargetSettings settings;
   settings.Profile = target;
   settings.CompilerOptions = std::vector<slang::CompilerOptionEntry>(additionalCompilerOptions.begin(), additionalCompilerOptions.end());
+  settings.Optimization = optimization;
 
   targets.push_back(settings);
   return Status{};
 }
 
+Status Compiler::AddPermutation(Permutation permutation) {
+  for (const auto &constant : permutation.Constants) {
+    if (constant.Type.empty() || constant.Name.empty() || constant.Value.empty()) {
+      return Status{StatusCode::Error, "Permutation constant requires type, name and value: " + constant.Name};
+    }
+  }
+  for (const auto &define : permutation.Defines) {
+    if (define.Name.empty()) {
+      return Status{StatusCode::Error, "Permutation define requires a name"};
+    }
+  }
+
+  permutations.push_back(std::move(permutation));
+  return Status{};
+}
+
+const Permutation &Compiler::GetPermutation(int64_t idx) const {
+  static const Permutation defaultPermutation;
+  return permutations.empty() ? defaultPermutation : permutations.at(idx);
+}
+
+int64_t Compiler::getSessionPermutation(int64_t permutationIdx) const {
+  const auto &permutation = GetPermutation(permutationIdx);
+  for (int64_t i = 0; i < permutationIdx; i++) {
+    if (permutations[i].HasSameDefines(permutation)) {
+      return i;
+    }
+  }
+  return permutationIdx;
+}
+
 Status Compiler::LoadProgramFromPath(std::string_view path) {
 
   std::ifstream file;
@@ -319,41 +669,135 @@ Status Compiler::LoadProgramFromPath(std::string_view path) {
 }
 
 Status Compiler::LoadProgram(std::string_view code) {
+  programVersion = 0;
+  linkedEntryPoints.clear();
+  loadedModule = nullptr;
+  loadSession = nullptr;
+  for (auto &context : contexts) {
+    context->Sessions.clear();
+  }
+  selectedEntryPoints.clear();
+  entryPointLinks.clear();
+  return loadProgram(code);
+}
+
+Status Compiler::UpdateProgram(std::string_view code) {
+  if (loadSession == nullptr) {
+    return LoadProgram(code);
+  }
+
+  // a failed update (for example a typo while editing, or a selected entry point renamed) keeps the previous program compilable
+  auto previousCode = std::move(inputCode);
+  auto previousEntryPoints = std::move(availableEntryPoints);
+  auto previousSelectedEntryPoints = std::move(selectedEntryPoints);
+  auto previousDependencies = std::move(dependencies);
+  auto previousPacking = std::move(uniformPacking);
+  auto previousModule = loadedModule;
+  auto previousLinkedEntryPoints = std::move(linkedEntryPoints);
+
+  selectedEntryPoints.clear();
+  programVersion++;
+  auto status = loadProgram(code);
+
+  // the selection is resolved before anything is replaced, so the update is applied whole or not at all
+  std::vector<EntryPoint> selection;
+  for (size_t i = 0; i < previousSelectedEntryPoints.size() && !status.IsError(); i++) {
+    const auto &name = previousSelectedEntryPoints[i].Name;
+    const auto it = std::ranges::find(availableEntryPoints, name, &EntryPoint::Name);
+    if (it == availableEntryPoints.end()) {
+      status = Status{StatusCode::Error, "Entry point not found: " + name};
+      break;
+    }
+    selection.push_back(*it);
+  }
+
+  if (status.IsError()) {
+    inputCode = std::move(previousCode);
+    availableEntryPoints = std::move(previousEntryPoints);
+    selectedEntryPoints = std::move(previousSelectedEntryPoints);
+    dependencies = std::move(previousDependencies);
+    uniformPacking = std::move(previousPacking);
+    loadedModule = previousModule;
+    linkedEntryPoints = std::move(previousLinkedEntryPoints);
+    // the sessions reload the previous source under a name the failed module didn't use
+    programVersion++;
+    return status;
+  }
+  selectedEntryPoints = std::move(selection);
+
+  // links of the entry points removed from the source are dropped
+  std::erase_if(entryPointLinks, [this](const auto &link) {
+    return std::ranges::find(availableEntryPoints, link.first, &EntryPoint::Name) == availableEntryPoints.end() ||
+           std::ranges::find(availableEntryPoints, link.second, &EntryPoint::Name) == availableEntryPoints.end();
+  });
+  return status;
+}
+
+std::string Compiler::getProgramModuleName() const {
+  return programVersion == 0 ? std::string(mainModuleName) : std::string(updatedModulePrefix) + std::to_string(programVersion);
+}
+
+Status Compiler::loadProgram(std::string_view code) {
   writeLog("Loading Program...");
   inputCode = code;
   std::string warnings;
 
   availableEntryPoints.clear();
-  selectedEntryPoints.clear();
 
-  Slang::ComPtr<slang::IComponentType> linkedProgram;
+  if (loadSession == nullptr) {
+    if (auto status = createSession(getContext(0), loadSession.writeRef(), -1, -1, 0); !status.IsOk()) {
+      return status;
+    }
+  }
+  auto &session = loadSession;
 
-  if (auto status = processProgram(code, linkedProgram.writeRef()); !status.IsOk()) {
+  Slang::ComPtr<slang::IModule> module;
+  if (auto status = loadModule(session, getSessionFingerprint(getContext(0), -1, -1, 0), inputCode, module.writeRef(), warnings);
+      status.IsError()) {
     return status;
   }
 
-  auto *layout = linkedProgram->getLayout(0, diagnostics.writeRef());
-  if (layout == nullptr) {
-    return Status{StatusCode::Error, diagnostics};
+  collectDependencies(session);
+
+  // nothing is linked here, the entry points are linked for their hashes when requested
+  loadedModule = module;
+  linkedEntryPoints.clear();
+
+  // the module layout has the global uniforms without linking any entry point
+  Slang::ComPtr<slang::IBlob> diagnostics;
+  uniformPacking = {};
+  if (!packedUniformsName.empty()) {
+    auto *layout = module->getLayout(0, diagnostics.writeRef());
+    if (layout == nullptr) {
+      return Status{StatusCode::Error, diagnostics};
+    }
+    appendWarnings(warnings, diagnostics);
+    if (auto status = packProgramUniforms(layout, packedUniformsName, uniformPacking); status.IsError()) {
+      return status;
+    }
   }
-  appendWarnings(warnings, diagnostics);
 
-  auto entryPointCount = layout->getEntryPointCount();
+  // only the names, stages and attributes, the stage comes from the layout of the single entry point
+  auto entryPointCount = module->getDefinedEntryPointCount();
   writeLog("   Found " + std::to_string(entryPointCount) + " entry points:");
   for (int i = 0; i < entryPointCount; i++) {
-    auto *ep = layout->getEntryPointByIndex(i);
-    auto entryPoint = EntryPoint::FromSlangEntryPoint(i, ep);
-    availableEntryPoints.push_back(entryPoint);
-
-    for (auto i = 0; i < targets.size(); i++) {
-      auto &target = targets.at(i);
-
-      Slang::ComPtr<slang::IBlob> entryPointHash;
-      linkedProgram->getEntryPointHash(entryPoint.Idx, i, entryPointHash.writeRef());
-      std::string hex = BgfxSlang::toHex(
-          std::span(reinterpret_cast<const uint8_t *>(entryPointHash->getBufferPointer()), entryPointHash->getBufferSize()));
+    Slang::ComPtr<slang::IEntryPoint> ep;
+    module->getDefinedEntryPoint(i, ep.writeRef());
+    diagnostics = nullptr;
+    auto *entryPointLayout = ep != nullptr ? ep->getLayout(0, diagnostics.writeRef()) : nullptr;
+    if (entryPointLayout == nullptr || entryPointLayout->getEntryPointCount() < 1) {
+      return diagnostics != nullptr ? Status{StatusCode::Error, diagnostics}
+                                     : Status{StatusCode::Error, "Failed to get the layout of entry point " + std::to_string(i)};
+    }
+    appendWarnings(warnings, diagnostics);
+    auto &entryPoint = availableEntryPoints.emplace_back(
+        EntryPoint::FromSlangEntryPoint(i, ep->getFunctionReflection(), entryPointLayout->getEntryPointByIndex(0)->getStage()));
+    for (const auto &target : targets) {
+      entryPoint.TargetHashes.push_back({target.Profile.Format, {}});
+    }
 
-      availableEntryPoints.back().TargetHashes.emplace_back(target.Profile.Format, hex);
+    if (verboseWriter == nullptr) {
+      continue;
     }
 
     // write entry point info
@@ -390,12 +834,28 @@ Status Compiler::LoadProgram(std::string_view code) {
   return !warnings.empty() ? Status{StatusCode::Warning, warnings} : Status{};
 }
 
-Status Compiler::createSession(slang::ISession **outSession, int64_t entryPointIdx, int64_t targetIdx) {
-  if (slangGlobalSession == nullptr) {
-    writeLog("CreateSession: Creating global session...");
-    SlangGlobalSessionDesc slangGlobalSessionDesc;
-    slang::createGlobalSession(&slangGlobalSessionDesc, slangGlobalSession.writeRef());
+Compiler::CompileContext &Compiler::getContext(size_t idx) {
+  while (contexts.size() <= idx) {
+    contexts.push_back(std::make_unique<CompileContext>());
   }
+  return *contexts[idx];
+}
+
+Status Compiler::createSession(CompileContext &context, slang::ISession **outSession, int64_t entryPointIdx, int64_t targetIdx,
+                               int64_t permutationIdx) {
+  ScopedSpan span(traceSink, "session");
+  if (context.GlobalSession == nullptr) {
+    ScopedSpan globalSessionSpan(traceSink, "global-session");
+    if (globalSessionPool != nullptr) {
+      context.GlobalSession = globalSessionPool->Acquire();
+    }
+    if (context.GlobalSession == nullptr) {
+      writeLog("CreateSession: Creating global session...");
+      SlangGlobalSessionDesc slangGlobalSessionDesc;
+      slang::createGlobalSession(&slangGlobalSessionDesc, context.GlobalSession.writeRef());
+    }
+  }
+  auto &slangGlobalSession = context.GlobalSession;
 
   slang::SessionDesc sessionDesc{};
   sessionDesc.defaultMatrixLayoutMode = SLANG_MATRIX_LAYOUT_COLUMN_MAJOR;
@@ -445,6 +905,10 @@ Status Compiler::createSession(slang::ISession **outSession, int64_t entryPointI
   sessionDesc.searchPathCount = modulesSearchPaths.size();
   sessionDesc.searchPaths = modulesSearchPathsChar.data();
 
+  for (const auto &define : GetPermutation(permutationIdx).Defines) {
+    macros.push_back({define.Name.c_str(), define.Value.c_str()});
+  }
+
   sessionDesc.preprocessorMacroCount = macros.size();
   sessionDesc.preprocessorMacros = macros.data();
 
@@ -453,38 +917,158 @@ Status Compiler::createSession(slang::ISession **outSession, int64_t entryPointI
   return Status{};
 }
 
-Status Compiler::processProgram(std::string_view code, slang::IComponentType **outProgram, int64_t entryPointIdx, int64_t targetIdx) {
-  slang::ISession *session;
-  std::string warnings;
-  if (auto status = createSession(&session, entryPointIdx, targetIdx); !status.IsOk()) {
+Status Compiler::getCompileSession(CompileContext &context, int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx,
+                                   CompileSession *&outSession, std::string &warnings) {
+  const auto &target = targets[targetIdx];
+  auto stage = target.HasStageOptions() ? availableEntryPoints[entryPointIdx].Stage : StageType::Unknown;
+  auto sessionPermutation = getSessionPermutation(permutationIdx);
+
+  for (auto &compileSession : context.Sessions) {
+    if (compileSession.TargetIdx != targetIdx || compileSession.Stage != stage || compileSession.PermutationIdx != sessionPermutation) {
+      continue;
+    }
+
+    // updated program is loaded into the existing session, the imported modules are already there
+    if (compileSession.ProgramVersion != programVersion) {
+      writeLog("Compile: Reloading program module for target " + std::string(target.Profile.Id) + "...");
+      const auto fingerprint = getSessionFingerprint(context, entryPointIdx, targetIdx, sessionPermutation);
+      Slang::ComPtr<slang::IModule> module;
+      if (auto status = loadModule(compileSession.Session, fingerprint, inputCode, module.writeRef(), warnings); status.IsError()) {
+        return status;
+      }
+      compileSession.Module = module;
+      compileSession.ProgramVersion = programVersion;
+    }
+    outSession = &compileSession;
+    return Status{};
+  }
+
+  CompileSession compileSession{targetIdx, stage, sessionPermutation, programVersion};
+  if (auto status = createSession(context, compileSession.Session.writeRef(), entryPointIdx, targetIdx, sessionPermutation);
+      !status.IsOk()) {
     return status;
   }
 
-  slang::IModule *module = session->loadModuleFromSourceString("sh", "sh.slang", code.data(), diagnostics.writeRef());
+  writeLog("Compile: Loading program module for target " + std::string(target.Profile.Id) + "...");
+  const auto fingerprint = getSessionFingerprint(context, entryPointIdx, targetIdx, sessionPermutation);
+  if (auto status = loadModule(compileSession.Session, fingerprint, inputCode, compileSession.Module.writeRef(), warnings);
+      status.IsError()) {
+    return status;
+  }
+
+  context.Sessions.push_back(std::move(compileSession));
+  outSession = &context.Sessions.back();
+  return Status{};
+}
+
+Status Compiler::getConstantsModule(CompileSession &compileSession, int64_t permutationIdx, slang::IModule *&outModule,
+                                    std::string &warnings) {
+  outModule = nullptr;
+  const auto &permutation = GetPermutation(permutationIdx);
+  if (permutation.Constants.empty()) {
+    return Status{};
+  }
+
+  for (const auto &[idx, module] : compileSession.ConstantModules) {
+    if (idx == permutationIdx) {
+      outModule = module;
+      return Status{};
+    }
+  }
+
+  const auto name = "permutation" + std::to_string(permutationIdx);
+  const auto source = permutation.GetConstantsSource();
+
+  Slang::ComPtr<slang::IBlob> diagnostics;
+  Slang::ComPtr<slang::IModule> module;
+  module = compileSession.Session->loadModuleFromSourceString(name.c_str(), (name + ".slang").c_str(), source.c_str(),
+                                                              diagnostics.writeRef());
+  if (module == nullptr) {
+    return Status{StatusCode::Error, diagnostics};
+  }
+  appendWarnings(warnings, diagnostics);
+
+  outModule = compileSession.ConstantModules.emplace_back(permutationIdx, std::move(module)).second;
+  return Status{};
+}
+
+Status Compiler::loadModule(slang::ISession *session, std::string_view fingerprint, std::string_view code, slang::IModule **outModule,
+                            std::string &warnings) {
+  ScopedSpan span(traceSink, "module-load");
+  std::vector<std::string> loadedModules;
+  if (moduleCache != nullptr) {
+    // modules loaded for the earlier versions of the program are neither preloaded nor stored again
+    for (SlangInt i = 0; i < session->getLoadedModuleCount(); i++) {
+      if (const auto *name = session->getLoadedModule(i)->getName(); name != nullptr) {
+        loadedModules.emplace_back(name);
+      }
+    }
+    preloadModules(session, fingerprint, code, loadedModules);
+  }
+
+  const auto name = getProgramModuleName();
+  const auto path = name + std::string(moduleExtension);
+  Slang::ComPtr<slang::IBlob> diagnostics;
+  slang::IModule *module = session->loadModuleFromSourceString(name.c_str(), path.c_str(), code.data(), diagnostics.writeRef());
   if (module == nullptr) {
     return Status{StatusCode::Error, diagnostics};
   }
   appendWarnings(warnings, diagnostics);
 
+  if (moduleCache != nullptr) {
+    storeModules(session, fingerprint, loadedModules);
+  }
+
+  module->addRef();
+  *outModule = module;
+  return Status{};
+}
+
+void Compiler::collectDependencies(slang::ISession *session) {
+  dependencies.clear();
+  auto addDependency = [&](const char *path) {
+    if (path == nullptr || *path == '\0' || isProgramModulePath(path) ||
+        std::find(dependencies.begin(), dependencies.end(), path) != dependencies.end()) {
+      return;
+    }
+    dependencies.emplace_back(path);
+  };
+
+  // modules loaded from the cache report the files they were built from as well
+  for (SlangInt i = 0; i < session->getLoadedModuleCount(); i++) {
+    auto *module = session->getLoadedModule(i);
+    addDependency(module->getFilePath());
+    for (int32_t j = 0; j < module->getDependencyFileCount(); j++) {
+      addDependency(module->getDependencyFilePath(j));
+    }
+  }
+}
+
+Status Compiler::linkProgram(slang::ISession *session, slang::IModule *module, slang::IComponentType **outProgram, std::string &warnings,
+                             int64_t entryPointIdx, slang::IModule *constantsModule) {
+  ScopedSpan span(traceSink, "link");
+  Slang::ComPtr<slang::IBlob> diagnostics;
+  std::vector<Slang::ComPtr<slang::IEntryPoint>> entryPoints;
   std::vector<slang::IComponentType *> components;
-  components.reserve(module->getDefinedEntryPointCount() + 1);
+  components.reserve(module->getDefinedEntryPointCount() + 2);
   components.push_back(module);
+  if (constantsModule != nullptr) {
+    components.push_back(constantsModule);
+  }
 
   if (entryPointIdx > -1) {
-    Slang::ComPtr<slang::IEntryPoint> entryPoint;
-    module->getDefinedEntryPoint(availableEntryPoints[entryPointIdx].Idx, entryPoint.writeRef());
-    components.push_back(entryPoint);
-
+    module->getDefinedEntryPoint(availableEntryPoints[entryPointIdx].Idx, entryPoints.emplace_back().writeRef());
   } else {
     for (int i = 0; i < module->getDefinedEntryPointCount(); i++) {
-      Slang::ComPtr<slang::IEntryPoint> entryPoint;
-      module->getDefinedEntryPoint(i, entryPoint.writeRef());
-      components.push_back(entryPoint);
+      module->getDefinedEntryPoint(i, entryPoints.emplace_back().writeRef());
     }
   }
+  for (const auto &entryPoint : entryPoints) {
+    components.push_back(entryPoint);
+  }
 
   Slang::ComPtr<slang::IComponentType> program;
-  writeLog("LoadProgram: Creating composite component type...");
+  writeLog("LinkProgram: Creating composite component type...");
 
   SlangResult res1 =
       session->createCompositeComponentType(components.data(), components.size(), program.writeRef(), diagnostics.writeRef());
@@ -493,14 +1077,14 @@ Status Compiler::processProgram(std::string_view code, slang::IComponentType **o
   }
   appendWarnings(warnings, diagnostics);
 
-  writeLog("LoadProgram: Linking program...");
+  writeLog("LinkProgram: Linking program...");
   SlangResult res2 = program->link(outProgram, diagnostics.writeRef());
   if (SLANG_FAILED(res2)) {
     return Status{StatusCode::Error, diagnostics};
   }
   appendWarnings(warnings, diagnostics);
 
-  return !warnings.empty() ? Status{StatusCode::Warning, warnings} : Status{};
+  return Status{};
 }
 
 Status Compiler::AddEntryPoint(std::string_view name) {
@@ -527,51 +1111,504 @@ Status Compiler::AddEntryPoint(StageType stage) {
   return Status{StatusCode::Error, "Entry point not found for stage: " + std::string(getStageShortName(stage))};
 }
 
-Status Compiler::Compile(int64_t entryPointIdx, int64_t targetIdx, IWriter &writer) {
-  Slang::ComPtr<slang::IComponentType> linkedProgram;
+Status Compiler::LinkEntryPoints(std::string_view vertexEntryPoint, std::string_view fragmentEntryPoint) {
+  const auto vertexIt = std::ranges::find(availableEntryPoints, vertexEntryPoint, &EntryPoint::Name);
+  const auto fragmentIt = std::ranges::find(availableEntryPoints, fragmentEntryPoint, &EntryPoint::Name);
+  if (vertexIt == availableEntryPoints.end() || fragmentIt == availableEntryPoints.end()) {
+    return Status{StatusCode::Error, "Entry point not found: " +
+                                         std::string(vertexIt == availableEntryPoints.end() ? vertexEntryPoint : fragmentEntryPoint)};
+  }
+  if (vertexIt->Stage != StageType::Vertex || fragmentIt->Stage != StageType::Fragment) {
+    return Status{StatusCode::Error, "Linked entry points must be a vertex and a fragment shader: " + std::string(vertexEntryPoint) +
+                                         ", " + std::string(fragmentEntryPoint)};
+  }
+  for (const auto &[vertexName, fragmentName] : entryPointLinks) {
+    if (vertexName == vertexEntryPoint || fragmentName == fragmentEntryPoint) {
+      return Status{StatusCode::Error, "Entry point is already linked: " +
+                                           std::string(vertexName == vertexEntryPoint ? vertexEntryPoint : fragmentEntryPoint)};
+    }
+  }
+
+  entryPointLinks.emplace_back(vertexEntryPoint, fragmentEntryPoint);
+  return Status{};
+}
+
+int64_t Compiler::GetLinkedEntryPoint(int64_t entryPointIdx) const {
+  if (entryPointIdx < 0 || static_cast<size_t>(entryPointIdx) >= availableEntryPoints.size()) {
+    return -1;
+  }
+
+  const auto &name = availableEntryPoints[entryPointIdx].Name;
+  for (const auto &[vertexName, fragmentName] : entryPointLinks) {
+    if (vertexName != name && fragmentName != name) {
+      continue;
+    }
+    const auto it = std::ranges::find(availableEntryPoints, vertexName == name ? fragmentName : vertexName, &EntryPoint::Name);
+    return it != availableEntryPoints.end() ? std::distance(availableEntryPoints.begin(), it) : -1;
+  }
+  return -1;
+}
+
+std::string_view Compiler::GetEntryPointHash(int64_t entryPointIdx, int64_t targetIdx) {
+  if (entryPointIdx < 0 || static_cast<size_t>(entryPointIdx) >= availableEntryPoints.size() || targetIdx < 0 ||
+      static_cast<size_t>(targetIdx) >= targets.size() || loadedModule == nullptr) {
+    return {};
+  }
+
+  auto &hash = availableEntryPoints[entryPointIdx].TargetHashes[targetIdx].Hash;
+  if (hash.empty()) {
+    ScopedSpan span(traceSink, "entry-point-hash");
+    // only this entry point is linked, once for all the targets
+    linkedEntryPoints.resize(availableEntryPoints.size());
+    auto &linkedEntryPoint = linkedEntryPoints[entryPointIdx];
+    std::string warnings;
+    if (linkedEntryPoint == nullptr &&
+        linkProgram(loadSession, loadedModule, linkedEntryPoint.writeRef(), warnings, entryPointIdx).IsError()) {
+      return {};
+    }
+    Slang::ComPtr<slang::IBlob> entryPointHash;
+    linkedEntryPoint->getEntryPointHash(0, targetIdx, entryPointHash.writeRef());
+    if (entryPointHash != nullptr) {
+      hash = toHex(std::span(static_cast<const uint8_t *>(entryPointHash->getBufferPointer()), entryPointHash->getBufferSize()));
+    }
+  }
+
+  // selected entry points are copies, they get the hash too
+  for (auto &entryPoint : selectedEntryPoints) {
+    if (entryPoint.Idx == entryPointIdx) {
+      entryPoint.TargetHashes[targetIdx].Hash = hash;
+    }
+  }
+  return hash;
+}
+
+CompiledShader Compiler::CompileToMemory(int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx) {
+  CompiledShader shader;
+  BufferWriter writer;
+  shader.Result = Compile(entryPointIdx, targetIdx, writer, permutationIdx);
+  if (shader.Result.IsError()) {
+    return shader;
+  }
+
+  shader.Data = std::make_shared<const std::vector<uint8_t>>(writer.Detach());
+  if (!readShaderReflection(*shader.Data, GetTarget(targetIdx).Format, shader.Reflection)) {
+    shader.Result = Status{StatusCode::Error, "Failed to read compiled shader header"};
+  }
+  return shader;
+}
+
+Status Compiler::Compile(int64_t entryPointIdx, int64_t targetIdx, IWriter &writer, int64_t permutationIdx) {
+  if (cache != nullptr) {
+    GetEntryPointHash(entryPointIdx, targetIdx);
+    GetEntryPointHash(GetLinkedEntryPoint(entryPointIdx), targetIdx);
+  }
+  return compile(getContext(0), entryPointIdx, targetIdx, permutationIdx, writer);
+}
+
+std::vector<CompileResult> Compiler::CompileAll(std::span<const CompileJob> jobs, uint32_t threadCount) {
+  std::vector<CompileResult> results(jobs.size());
+  if (jobs.empty()) {
+    return results;
+  }
+
+  // jobs sharing a compile session are kept next to each other, so a worker usually reuses the module it already loaded
+  auto sessionKey = [this](const CompileJob &job) {
+    auto stage = targets[job.TargetIdx].HasStageOptions() ? availableEntryPoints[job.EntryPointIdx].Stage : StageType::Unknown;
+    return std::make_tuple(job.TargetIdx, static_cast<int>(stage), getSessionPermutation(job.PermutationIdx));
+  };
+
+  std::vector<size_t> order(jobs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sessionKey(jobs[a]) < sessionKey(jobs[b]); });
+
+  // chunks of jobs handed out to workers, either whole sessions or single jobs when there are fewer sessions than threads
+  std::vector<std::pair<size_t, size_t>> chunks;
+  for (size_t i = 0; i < order.size();) {
+    size_t end = i + 1;
+    while (end < order.size() && sessionKey(jobs[order[end]]) == sessionKey(jobs[order[i]])) {
+      end++;
+    }
+    chunks.emplace_back(i, end);
+    i = end;
+  }
+
+  if (threadCount == 0) {
+    threadCount = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  // the hashes link the entry points in the session of LoadProgram, it can't be used from the workers
+  if (cache != nullptr) {
+    for (const auto &job : jobs) {
+      GetEntryPointHash(job.EntryPointIdx, job.TargetIdx);
+      GetEntryPointHash(GetLinkedEntryPoint(job.EntryPointIdx), job.TargetIdx);
+    }
+  }
+
+  if (chunks.size() < threadCount) {
+    chunks.clear();
+    for (size_t i = 0; i < order.size(); i++) {
+      chunks.emplace_back(i, i + 1);
+    }
+  }
+
+  const auto workerCount = std::min<size_t>(threadCount, chunks.size());
+  for (size_t i = 0; i < workerCount; i++) {
+    getContext(i);
+  }
+
+  std::atomic<size_t> nextChunk = 0;
+  auto worker = [&](CompileContext &context) {
+    for (size_t chunkIdx = nextChunk++; chunkIdx < chunks.size(); chunkIdx = nextChunk++) {
+      for (size_t i = chunks[chunkIdx].first; i < chunks[chunkIdx].second; i++) {
+        const auto &job = jobs[order[i]];
+        auto &result = results[order[i]];
+        BufferWriter writer;
+        result.EntryPointIdx = job.EntryPointIdx;
+        result.TargetIdx = job.TargetIdx;
+        result.PermutationIdx = job.PermutationIdx;
+        // one span per job, so the trace shows which shaders are on the critical path
+        const auto spanName = traceSink != nullptr ? "compile " + availableEntryPoints[job.EntryPointIdx].Name + " (" +
+                                                         std::string(targets[job.TargetIdx].Profile.Name) + ")"
+                                                   : std::string{};
+        ScopedSpan span(traceSink, spanName);
+        result.Result = compile(context, job.EntryPointIdx, job.TargetIdx, job.PermutationIdx, writer);
+        result.Data = writer.Detach();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workerCount - 1);
+  for (size_t i = 1; i < workerCount; i++) {
+    threads.emplace_back(worker, std::ref(*contexts[i]));
+  }
+  worker(*contexts[0]);
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  markDuplicates(results);
+  return results;
+}
+
+void Compiler::appendTargetKey(std::string &key, const TargetSettings &target, StageType stage) const {
+  key += ";" + std::string(target.Profile.Id);
+  if (target.Optimization.OptimizesSpirv) {
+    key += ";O";
+  }
+
+  for (const auto &option : target.GetCompilerOptions(stage)) {
+    key += ";o" + std::to_string(static_cast<int>(option.name)) + ":" + std::to_string(option.value.intValue0) + ":" +
+           std::to_string(option.value.intValue1);
+    if (option.value.stringValue0 != nullptr) {
+      key += std::string(":") + option.value.stringValue0;
+    }
+    if (option.value.stringValue1 != nullptr) {
+      key += std::string(":") + option.value.stringValue1;
+    }
+  }
+
+  std::vector<slang::PreprocessorMacroDesc> macros;
+  target.Profile.AddTargetMacros(macros);
+  for (const auto &macro : macros) {
+    key += std::string(";d") + macro.name + "=" + macro.value;
+  }
+}
+
+void Compiler::appendDefinesKey(std::string &key, int64_t permutationIdx) const {
+  for (const auto &define : GetPermutation(permutationIdx).Defines) {
+    key += ";D" + define.Name + "=" + define.Value;
+  }
+}
+
+std::string Compiler::getCacheKey(int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx) const {
+  const auto &entryPoint = availableEntryPoints[entryPointIdx];
+  if (static_cast<size_t>(targetIdx) >= entryPoint.TargetHashes.size() || entryPoint.TargetHashes[targetIdx].Hash.empty()) {
+    return {};
+  }
+
+  std::string key = entryPoint.TargetHashes[targetIdx].Hash;
+  key += ";v" + std::to_string(version) + "." + std::to_string(cacheVersion) + ";b" + std::string(buildId);
+  key += ";s" + std::string(spGetBuildTagString());
+  appendTargetKey(key, targets[targetIdx], entryPoint.Stage);
+  key += ";" + std::string(getStageShortName(entryPoint.Stage));
+
+  // the linked entry point decides which varyings are kept
+  if (const auto linkedIdx = GetLinkedEntryPoint(entryPointIdx); linkedIdx > -1) {
+    const auto &linkedHash = availableEntryPoints[linkedIdx].TargetHashes[targetIdx].Hash;
+    if (linkedHash.empty()) {
+      return {};
+    }
+    key += ";L" + linkedHash;
+  }
+
+  for (const auto &path : modulesSearchPaths) {
+    key += ";i" + path;
+  }
+
+  if (compactsUniformBuffers) {
+    key += ";U";
+  }
+
+  if (!uniformPacking.IsEmpty()) {
+    key += ";P" + uniformPacking.Name;
+    for (const auto &field : uniformPacking.Fields) {
+      key += ":" + field.Name + "=" + std::to_string(field.GetFloatIndex());
+    }
+  }
+
+  appendDefinesKey(key, permutationIdx);
+  for (const auto &constant : GetPermutation(permutationIdx).Constants) {
+    key += ";C" + constant.Type + " " + constant.Name + "=" + constant.Value;
+  }
+  return key;
+}
+
+std::string Compiler::getSessionFingerprint(CompileContext &context, int64_t entryPointIdx, int64_t targetIdx,
+                                            int64_t permutationIdx) const {
+  std::string fingerprint = context.GlobalSession->getBuildTagString();
+
+  if (targetIdx > -1) {
+    auto stage = entryPointIdx > -1 ? availableEntryPoints[entryPointIdx].Stage : StageType::Unknown;
+    appendTargetKey(fingerprint, targets[targetIdx], stage);
+  } else {
+    for (const auto &target : targets) {
+      appendTargetKey(fingerprint, target, StageType::Vertex);
+    }
+  }
+
+  for (const auto &path : modulesSearchPaths) {
+    fingerprint += ";i" + path;
+  }
+  appendDefinesKey(fingerprint, permutationIdx);
+  return fingerprint;
+}
+
+void Compiler::preloadModules(slang::ISession *session, std::string_view fingerprint, std::string_view code,
+                              std::vector<std::string> &loadedModules) {
+  for (const auto &name : ModuleCache::FindImports(code)) {
+    preloadModule(session, fingerprint, name, loadedModules);
+  }
+}
+
+void Compiler::preloadModule(slang::ISession *session, std::string_view fingerprint, const std::string &name,
+                             std::vector<std::string> &loadedModules) {
+  if (std::find(loadedModules.begin(), loadedModules.end(), name) != loadedModules.end()) {
+    return;
+  }
+
+  auto entry = moduleCache->Find(fingerprint, name);
+  if (entry == nullptr) {
+    return;
+  }
+
+  // dependencies first, so they are not loaded from the sources when the module is deserialized
+  loadedModules.push_back(name);
+  for (const auto &import : entry->Imports) {
+    preloadModule(session, fingerprint, import, loadedModules);
+  }
+
+  if (!session->isBinaryModuleUpToDate(entry->Path.c_str(), entry->Blob)) {
+    writeLog("LoadModule: Cached module " + name + " is out of date");
+    std::erase(loadedModules, name);
+    return;
+  }
 
-  if (auto status = processProgram(inputCode, linkedProgram.writeRef(), entryPointIdx, targetIdx); !status.IsOk()) {
+  Slang::ComPtr<slang::IBlob> diagnostics;
+  if (session->loadModuleFromIRBlob(name.c_str(), entry->Path.c_str(), entry->Blob, diagnostics.writeRef()) == nullptr) {
+    writeLog("LoadModule: Failed to load cached module " + name);
+    std::erase(loadedModules, name);
+    return;
+  }
+  writeLog("LoadModule: Loaded cached module " + name);
+}
+
+void Compiler::storeModules(slang::ISession *session, std::string_view fingerprint, const std::vector<std::string> &loadedModules) {
+  for (SlangInt i = 0; i < session->getLoadedModuleCount(); i++) {
+    auto *module = session->getLoadedModule(i);
+    const auto *name = module->getName();
+    const auto *path = module->getFilePath();
+    if (name == nullptr || path == nullptr || isProgramModuleName(name) ||
+        std::find(loadedModules.begin(), loadedModules.end(), name) != loadedModules.end()) {
+      continue;
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+      continue;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+
+    Slang::ComPtr<ISlangBlob> serialized;
+    if (SLANG_FAILED(module->serialize(serialized.writeRef()))) {
+      continue;
+    }
+
+    // copied as the cached blobs are shared by sessions used on other threads
+    const auto *data = static_cast<const uint8_t *>(serialized->getBufferPointer());
+    ModuleCache::Entry entry{path, ModuleCache::FindImports(source.str()),
+                             MemoryBlob::Create(std::vector<uint8_t>(data, data + serialized->getBufferSize()))};
+    writeLog("LoadModule: Storing module " + std::string(name) + " in the module cache");
+    moduleCache->Store(fingerprint, name, std::move(entry));
+  }
+}
+
+Status Compiler::compile(CompileContext &context, int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx, IWriter &writer) {
+  auto cacheKey = cache != nullptr ? getCacheKey(entryPointIdx, targetIdx, permutationIdx) : std::string{};
+  if (cacheKey.empty()) {
+    return compileProgram(context, entryPointIdx, targetIdx, permutationIdx, writer);
+  }
+
+  // entry: warnings size, warnings and the shader blob
+  std::vector<uint8_t> cachedData;
+  uint32_t warningsSize = 0;
+  if (cache->Load(cacheKey, cachedData) && cachedData.size() >= sizeof(warningsSize)) {
+    std::memcpy(&warningsSize, cachedData.data(), sizeof(warningsSize));
+    const auto entry = std::span<const uint8_t>(cachedData).subspan(sizeof(warningsSize));
+    if (warningsSize <= entry.size()) {
+      writeLog("Compile: Cache hit for entry point " + availableEntryPoints[entryPointIdx].Name + " (" +
+               std::string(targets[targetIdx].Profile.Id) + ")");
+      std::string warnings(reinterpret_cast<const char *>(entry.data()), warningsSize);
+      writer.Write(entry.data() + warningsSize, entry.size() - warningsSize);
+      return !warnings.empty() ? Status{StatusCode::Warning, std::move(warnings)} : Status{};
+    }
+  }
+
+  BufferWriter buffer;
+  auto status = compileProgram(context, entryPointIdx, targetIdx, permutationIdx, buffer);
+  if (status.IsError()) {
     return status;
   }
 
-  auto target = targets[targetIdx].Profile;
+  auto data = buffer.GetData();
+  const auto warnings = status.GetMessage();
+  warningsSize = static_cast<uint32_t>(warnings.size());
+  std::vector<uint8_t> entry(sizeof(warningsSize));
+  std::memcpy(entry.data(), &warningsSize, sizeof(warningsSize));
+  entry.insert(entry.end(), warnings.begin(), warnings.end());
+  entry.insert(entry.end(), data.begin(), data.end());
+  if (!cache->Store(cacheKey, entry)) {
+    writeLog("Compile: Failed to store cache entry in " + cache->GetDirectory().string());
+  }
+  writer.Write(data.data(), data.size());
+  return status;
+}
 
+Status Compiler::compileProgram(CompileContext &context, int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx,
+                                IWriter &writer) {
   std::string warnings;
-  int64_t processedTargetIndex = 0;   // we always compile one target at a time
-  int64_t processedEntryPointIdx = 0; // we always compile one entry point at a time
 
-  auto *layout = linkedProgram->getLayout(processedTargetIndex, diagnostics.writeRef());
+  CompileSession *compileSession = nullptr;
+  if (auto status = getCompileSession(context, entryPointIdx, targetIdx, permutationIdx, compileSession, warnings); status.IsError()) {
+    return status;
+  }
 
-  if (layout == nullptr) {
-    return Status{StatusCode::Error, diagnostics};
+  slang::IModule *constantsModule = nullptr;
+  if (auto status = getConstantsModule(*compileSession, permutationIdx, constantsModule, warnings); status.IsError()) {
+    return status;
   }
 
-  if (diagnostics != nullptr) {
-    appendWarnings(warnings, diagnostics);
+  Slang::ComPtr<slang::IComponentType> linkedProgram;
+  if (auto status = linkProgram(compileSession->Session, compileSession->Module, linkedProgram.writeRef(), warnings, entryPointIdx,
+                                constantsModule);
+      status.IsError()) {
+    return status;
   }
 
-  auto *entryPointLayout = layout->getEntryPointByIndex(processedEntryPointIdx);
-  auto stage = entryPointLayout->getStage();
+  auto target = targets[targetIdx].Profile;
+  const bool optimizesSpirv = targets[targetIdx].Optimization.OptimizesSpirv;
+
+  int64_t processedTargetIndex = 0;   // we always compile one target at a time
+  int64_t processedEntryPointIdx = 0; // we always compile one entry point at a time
 
+  Slang::ComPtr<slang::IBlob> diagnostics;
+  SlangStage stage = SLANG_STAGE_NONE;
   std::vector<Param> inputParams;
   std::vector<Param> outputParams;
-  if (auto status = getInputParams(layout->getEntryPointByIndex(processedEntryPointIdx), inputParams); !status.IsOk()) {
-    return status;
+  Slang::ComPtr<slang::IBlob> code;
+  {
+    ScopedSpan span(traceSink, "codegen");
+    SlangResult result =
+        linkedProgram->getEntryPointCode(processedEntryPointIdx, processedTargetIndex, code.writeRef(), diagnostics.writeRef());
+    if (SLANG_FAILED(result)) {
+      return Status{StatusCode::Error, diagnostics};
+    }
   }
-  if (auto status = getOutputParams(layout->getEntryPointByIndex(processedEntryPointIdx), outputParams); !status.IsOk()) {
-    return status;
+  if (diagnostics != nullptr) {
+    appendWarnings(warnings, diagnostics);
   }
 
-  slang::IMetadata *entryPointMetadata;
-  linkedProgram->getEntryPointMetadata(processedEntryPointIdx, processedTargetIndex, &entryPointMetadata);
-
   std::vector<Uniform> uniforms;
   uint16_t uniformBufferSize = 0;
-  if (auto status = getUniforms(layout, entryPointMetadata, target, stage, uniforms, uniformBufferSize); !status.IsOk()) {
-    return status;
+  // new offsets of the uniform buffer members when the uniforms are packed or the buffer is compacted
+  std::vector<std::pair<std::string, uint32_t>> memberOffsets;
+  {
+    ScopedSpan span(traceSink, "reflection");
+    auto *layout = linkedProgram->getLayout(processedTargetIndex, diagnostics.writeRef());
+
+    if (layout == nullptr) {
+      return Status{StatusCode::Error, diagnostics};
+    }
+
+    if (diagnostics != nullptr) {
+      appendWarnings(warnings, diagnostics);
+    }
+
+    auto *entryPointLayout = layout->getEntryPointByIndex(processedEntryPointIdx);
+    stage = entryPointLayout->getStage();
+
+    if (auto status = getInputParams(layout->getEntryPointByIndex(processedEntryPointIdx), inputParams); !status.IsOk()) {
+      return status;
+    }
+    if (auto status = getOutputParams(layout->getEntryPointByIndex(processedEntryPointIdx), outputParams); !status.IsOk()) {
+      return status;
+    }
+
+    slang::IMetadata *entryPointMetadata;
+    linkedProgram->getEntryPointMetadata(processedEntryPointIdx, processedTargetIndex, &entryPointMetadata);
+
+    // the slang metadata marks the whole buffer used, the SPIR-V code tells which members are read
+    std::vector<std::string> usedMembers;
+    bool knowsUsedMembers = false;
+    if (compactsUniformBuffers && target.Format == TargetFormat::SpirV) {
+      slang::VariableLayoutReflection *elementsVarLayout = layout->getGlobalParamsVarLayout();
+      slang::TypeLayoutReflection *elementsTypeLayout = nullptr;
+      std::vector<std::string> memberNames;
+      if (verifyUniformLayout(elementsVarLayout->getTypeLayout(), elementsVarLayout, elementsTypeLayout).IsOk()) {
+        for (int i = 0; i < elementsTypeLayout->getFieldCount(); i++) {
+          memberNames.emplace_back(elementsTypeLayout->getFieldByIndex(i)->getName());
+        }
+      }
+      knowsUsedMembers = getUsedUniformBufferMembers(
+          {static_cast<const uint32_t *>(code->getBufferPointer()), code->getBufferSize() / sizeof(uint32_t)}, memberNames, usedMembers);
+    }
+
+    if (auto status = getUniforms(layout, entryPointMetadata, target, stage, uniformPacking, compactsUniformBuffers,
+                                  knowsUsedMembers ? &usedMembers : nullptr, uniforms, uniformBufferSize, memberOffsets);
+        !status.IsOk()) {
+      return status;
+    }
+  }
+
+  // varyings of the linked program: the vertex outputs the fragment shader reads, the shaders hash only them
+  const auto linkedEntryPointIdx = GetLinkedEntryPoint(entryPointIdx);
+  const bool isLinked = linkedEntryPointIdx > -1;
+  std::vector<Param> linkedVaryings;
+  if (isLinked) {
+    if (auto status = getLinkedVaryings(*compileSession, constantsModule, linkedEntryPointIdx, stage,
+                                        stage == SLANG_STAGE_VERTEX ? outputParams : inputParams, linkedVaryings, warnings);
+        status.IsError()) {
+      return status;
+    }
   }
 
   if (verboseWriter != nullptr) {
+    if (isLinked) {
+      writeLog("   Linked with " + availableEntryPoints[linkedEntryPointIdx].Name + ", " + std::to_string(linkedVaryings.size()) +
+               " varyings");
+    }
     writeLog("   Found " + std::to_string(inputParams.size()) + " input params:");
     for (const auto &param : inputParams) {
       writeLog("      - " + param.Name + " (" + std::string(attribToString(param.Attr)) + ")");
@@ -587,68 +1624,141 @@ Status Compiler::Compile(int64_t entryPointIdx, int64_t targetIdx, IWriter &writ
     }
   }
 
-  Slang::ComPtr<slang::IBlob> code;
-  SlangResult result =
-      linkedProgram->getEntryPointCode(processedEntryPointIdx, processedTargetIndex, code.writeRef(), diagnostics.writeRef());
-  if (SLANG_FAILED(result)) {
-    return Status{StatusCode::Error, diagnostics};
-  }
-  if (diagnostics != nullptr) {
-    appendWarnings(warnings, diagnostics);
-  }
-
-  std::string source(reinterpret_cast<const char *>(code->getBufferPointer()), code->getBufferSize());
-
   auto magic = GetMagic(stage);
   if (magic == 0) {
     return Status{StatusCode::Error, "Unsupported stage"};
   }
 
-  writer.Write(magic);
+  const bool isGlsl = target.Format == TargetFormat::OpenGL || target.Format == TargetFormat::OpenGLES;
+
+  // the outputs of the linked vertex shader the fragment shader doesn't read are removed from SPIR-V, here for the SPIR-V target and
+  // by writeGlslShader before SPIRV-Cross, DirectX shaders only get the linked hash
+  const bool removesOutputs = isLinked && stage == SLANG_STAGE_VERTEX;
+  std::vector<std::string> usedOutputs;
+  if (removesOutputs) {
+    std::ranges::transform(linkedVaryings, std::back_inserter(usedOutputs), &Param::Name);
+  }
+
+  std::span<const uint8_t> codeData{static_cast<const uint8_t *>(code->getBufferPointer()), code->getBufferSize()};
+  std::vector<uint32_t> spirv;
+  if (target.Format == TargetFormat::SpirV && (removesOutputs || !memberOffsets.empty() || optimizesSpirv)) {
+    ScopedSpan span(traceSink, "spirv-passes");
+    const auto *words = static_cast<const uint32_t *>(code->getBufferPointer());
+    spirv.assign(words, words + code->getBufferSize() / sizeof(uint32_t));
+    // the header hashes only the linked varyings, a shader keeping the other outputs wouldn't match it
+    if (removesOutputs && !removeUnusedOutputs(spirv, usedOutputs)) {
+      return Status{StatusCode::Error, "Failed to remove the outputs the linked fragment shader doesn't read"};
+    }
+    if (!memberOffsets.empty() && !setUniformBufferOffsets(spirv, memberOffsets)) {
+      return Status{StatusCode::Error, "Failed to change the uniform buffer layout"};
+    }
+    // last, the other passes find the members and outputs by name
+    if (optimizesSpirv) {
+      optimizeSpirv(spirv, true);
+    }
+    codeData = {reinterpret_cast<const uint8_t *>(spirv.data()), spirv.size() * sizeof(uint32_t)};
+  }
 
-  auto hashInput = magic == magicFsh ? hashParams(inputParams) : 0;
-  auto hashOutput = magic == magicVsh ? hashParams(outputParams) : 0;
-  writer.Write(hashInput);
-  writer.Write(hashOutput);
+  // exact blob size, the GLSL code is generated later and reserved by writeGlslShader
+  size_t blobSize = headerFieldsSize;
+  for (const auto &uniform : uniforms) {
+    blobSize += uniformFieldsSize + getUniformNameSize(uniform);
+  }
+  if (!isGlsl) {
+    blobSize += sizeof(uint32_t) + codeData.size() + sizeof(uint8_t) + sizeof(uint8_t) + inputParams.size() * sizeof(uint16_t) +
+                sizeof(uniformBufferSize);
+  }
+  writer.Reserve(blobSize);
 
-  writer.Write<uint16_t>(uniforms.size());
+  PackedRecord<headerFieldsSize> header;
+  header.Append(magic);
+  header.Append(magic == magicFsh ? hashParams(isLinked ? linkedVaryings : inputParams) : 0U);
+  header.Append(magic == magicVsh ? hashParams(isLinked ? linkedVaryings : outputParams) : 0U);
+  header.Append<uint16_t>(uniforms.size());
+  header.WriteTo(writer);
 
   const uint32_t fragmentBit = stage == SLANG_STAGE_FRAGMENT ? kUniformFragmentBit : 0;
 
   for (const auto &uniform : uniforms) {
-    uint8_t nameSize = uniform.Name.size();
-    writer.Write(nameSize);
-    writer.Write(uniform.Name.data(), nameSize);
-    uint8_t type = static_cast<uint8_t>(uniform.Type) | fragmentBit;
-    writer.Write(type);
-    writer.Write(uniform.Count);
-    writer.Write(uniform.RegIndex);
-    writer.Write(uniform.RegCount);
-    writer.Write(uniform.TexComponent);
-    writer.Write(uniform.TexDimension);
-    writer.Write(uniform.TexFormat);
+    PackedRecord<uniformFieldsSize + maxUniformNameSize> record;
+    const auto nameSize = static_cast<uint8_t>(getUniformNameSize(uniform));
+    record.Append(nameSize);
+    record.Append(uniform.Name.data(), nameSize);
+    record.Append(static_cast<uint8_t>(static_cast<uint8_t>(uniform.Type) | fragmentBit));
+    record.Append(uniform.Count);
+    record.Append(uniform.RegIndex);
+    record.Append(uniform.RegCount);
+    record.Append(uniform.TexComponent);
+    record.Append(uniform.TexDimension);
+    record.Append(uniform.TexFormat);
+    record.WriteTo(writer);
   }
 
-  if (target.Format == TargetFormat::OpenGL || target.Format == TargetFormat::OpenGLES) {
-    return writeGlslShader(linkedProgram, target, processedEntryPointIdx, processedTargetIndex, writer, inputParams, uniforms);
+  if (isGlsl) {
+    return writeGlslShader(linkedProgram, target, processedEntryPointIdx, processedTargetIndex, writer, inputParams, uniforms,
+                           traceSink, removesOutputs ? &usedOutputs : nullptr, uniformPacking.IsEmpty() ? nullptr : &uniformPacking,
+                           optimizesSpirv);
   }
 
-  uint32_t codeSize = code->getBufferSize();
+  ScopedSpan span(traceSink, "write");
+  // the code is referenced straight from the slang blob (or the SPIR-V the passes changed), file writers don't copy it
+  std::shared_ptr<const void> codeOwner;
+  if (spirv.empty()) {
+    codeOwner = std::shared_ptr<const void>(code->getBufferPointer(), [code](const void *) {});
+  } else {
+    codeOwner = std::make_shared<const std::vector<uint32_t>>(std::move(spirv));
+  }
+  uint32_t codeSize = codeData.size();
   writer.Write(codeSize);
-  writer.Write(code->getBufferPointer(), codeSize);
+  writer.WriteShared(codeData, std::move(codeOwner));
+
+  // nul terminator, attribute count and ids (up to 255) and the uniform buffer size
+  PackedRecord<sizeof(uint8_t) * 2 + sizeof(uint16_t) * std::numeric_limits<uint8_t>::max() + sizeof(uniformBufferSize)> footer;
+  footer.Append<uint8_t>(0);
+  footer.Append<uint8_t>(inputParams.size());
+  for (size_t i = 0; i < std::min<size_t>(inputParams.size(), std::numeric_limits<uint8_t>::max()); i++) {
+    footer.Append(paramToId(inputParams[i], target.Format));
+  }
+  footer.Append(uniformBufferSize);
+  footer.WriteTo(writer);
 
-  uint8_t nul = 0;
-  writer.Write(nul);
+  return !warnings.empty() ? Status{StatusCode::Warning, warnings} : Status{};
+}
 
-  writer.Write<uint8_t>(inputParams.size());
-  for (const auto &param : inputParams) {
-    uint16_t attrId = paramToId(param, target.Format);
-    writer.Write(attrId);
+Status Compiler::getLinkedVaryings(CompileSession &compileSession, slang::IModule *constantsModule, int64_t linkedEntryPointIdx,
+                                   SlangStage stage, const std::vector<Param> &params, std::vector<Param> &outVaryings,
+                                   std::string &warnings) {
+  ScopedSpan span(traceSink, "program-link");
+  // the linked entry point is linked alone in the same session, only for its reflection
+  Slang::ComPtr<slang::IComponentType> linkedProgram;
+  if (auto status = linkProgram(compileSession.Session, compileSession.Module, linkedProgram.writeRef(), warnings, linkedEntryPointIdx,
+                                constantsModule);
+      status.IsError()) {
+    return status;
   }
 
-  writer.Write(uniformBufferSize);
+  Slang::ComPtr<slang::IBlob> diagnostics;
+  auto *layout = linkedProgram->getLayout(0, diagnostics.writeRef());
+  if (layout == nullptr) {
+    return Status{StatusCode::Error, diagnostics};
+  }
 
-  return !warnings.empty() ? Status{StatusCode::Warning, warnings} : Status{};
+  const bool isVertex = stage == SLANG_STAGE_VERTEX;
+  std::vector<Param> linkedParams;
+  auto status = isVertex ? getInputParams(layout->getEntryPointByIndex(0), linkedParams)
+                         : getOutputParams(layout->getEntryPointByIndex(0), linkedParams);
+  if (!status.IsOk()) {
+    return status;
+  }
+
+  const auto &vertexOutputs = isVertex ? params : linkedParams;
+  const auto &fragmentInputs = isVertex ? linkedParams : params;
+  for (const auto &output : vertexOutputs) {
+    if (std::ranges::find(fragmentInputs, output.Name, &Param::Name) != fragmentInputs.end()) {
+      outVaryings.push_back(output);
+    }
+  }
+  return Status{};
 }
 
 const EntryPoint *Compiler::GetEntryPointByIndex(int64_t idx) const {
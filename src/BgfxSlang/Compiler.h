@@ -1,62 +1,234 @@
 #pragma once
 
+#include "CompileCache.h"
 #include "EntryPoint.h"
+#include "GlobalSessionPool.h"
+#include "ModuleCache.h"
+#include "Permutation.h"
 #include "Status.h"
 #include "Target.h"
 #include "Types.h"
+#include "UniformPacking.h"
 #include "Utils/IWriter.h"
+#include "Utils/Trace.h"
+#include <algorithm>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <slang-com-ptr.h>
 #include <slang.h>
 #include <span>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace BgfxSlang {
 
+struct CompileJob {
+  int64_t EntryPointIdx;
+  int64_t TargetIdx;
+  int64_t PermutationIdx = 0;
+};
+
+struct CompileResult {
+  int64_t EntryPointIdx;
+  int64_t TargetIdx;
+  int64_t PermutationIdx = 0;
+  Status Result;
+  std::vector<uint8_t> Data;
+  // index of the earlier result with byte-identical data, Data of the duplicate is left empty
+  int64_t DuplicateOf = -1;
+};
+
+// Shader summary read from the compiled bgfx shader blob.
+struct ShaderReflection {
+  StageType Stage = StageType::Unknown;
+  // hashes bgfx uses to match the vertex shader outputs with the fragment shader inputs
+  uint32_t InputHash = 0;
+  uint32_t OutputHash = 0;
+  std::vector<Uniform> Uniforms;
+  // vertex attributes the vertex shader reads, without the instance data
+  std::vector<Attrib> Attributes;
+};
+
+// Reads the summary of the bgfx shader blob compiled for the target format, works for the blobs from the compile cache too. With
+// unknown format the attributes are not read.
+bool readShaderReflection(std::span<const uint8_t> blob, TargetFormat format, ShaderReflection &reflection);
+
+struct CompiledShader {
+  Status Result;
+  // bgfx shader blob, shared so it can be handed to the renderer (bgfx::makeRef) while the compiler keeps going
+  std::shared_ptr<const std::vector<uint8_t>> Data;
+  ShaderReflection Reflection;
+
+  [[nodiscard]] std::span<const uint8_t> GetData() const {
+    return Data != nullptr ? std::span<const uint8_t>{*Data} : std::span<const uint8_t>{};
+  }
+};
+
 class Compiler {
 public:
   Compiler() = default;
+  ~Compiler();
   Compiler(const Compiler &) = delete;
   Compiler &operator=(const Compiler &) = delete;
   Compiler(Compiler &&) = delete;
   Compiler &operator=(Compiler &&) = delete;
 
   void SetVerboseWriter(IWriter *writer) { verboseWriter = writer; }
+  void SetCache(const CompileCache *compileCache) { cache = compileCache; }
+  // Imported modules are serialized to the module cache and loaded from it by later sessions. Can be shared by many compilers.
+  void SetModuleCache(ModuleCache *cache) { moduleCache = cache; }
+  // Global sessions are taken from the pool instead of being created for every compiler. Must be set before LoadProgram.
+  void SetGlobalSessionPool(GlobalSessionPool *pool) { globalSessionPool = pool; }
+  // Timing of the compile phases, the sink gets the spans from every worker thread.
+  void SetTraceSink(ITraceSink *sink) { traceSink = sink; }
+
+  // Global float, float2 and float3 uniforms are packed into one vec4 array uniform with the name (GetUniformPacking has the layout),
+  // bgfx has no uniform types for them. Supported by SPIR-V, GLSL and GLSL ES targets. Empty name disables the packing.
+  // Must be set before LoadProgram.
+  void SetUniformPacking(std::string_view packedUniformName) { packedUniformsName = packedUniformName; }
+  // The global uniform buffer of every SPIR-V shader is laid out again with only the uniforms the shader reads, one after another,
+  // so bgfx uploads less data per draw. DirectX shaders keep the whole buffer.
+  void SetUniformBufferCompaction(bool compact) { compactsUniformBuffers = compact; }
 
   Status AddTarget(std::string_view profile, std::span<slang::CompilerOptionEntry> additionalCompilerOptions = {});
+  // Target with the optimization settings, the other one optimizes the most in slang only.
+  Status AddTarget(std::string_view profile, TargetOptimization optimization,
+                   std::span<slang::CompilerOptionEntry> additionalCompilerOptions = {});
+  // Permutations must be added before LoadProgram, entry points are found with the defines of the first one.
+  Status AddPermutation(Permutation permutation);
   Status LoadProgram(std::string_view code);
   Status LoadProgramFromPath(std::string_view path);
+  // Replaces the program source keeping the slang sessions, so the imported modules are not loaded again and the next compilations
+  // only parse the new source. Selected entry points are selected again by name. Changes of the imported modules need LoadProgram.
+  // On error, including a selected entry point missing from the new source, the previous program stays loaded.
+  Status UpdateProgram(std::string_view code);
 
   Status AddEntryPoint(std::string_view name);
   Status AddEntryPoint(StageType stage);
 
+  // Compiles the vertex and fragment entry points as one program: the vertex shader keeps only the outputs the fragment shader
+  // reads (the computations of the others are removed in SPIR-V and GLSL) and both shaders hash only these varyings.
+  // An entry point can be in one link. The links are kept by UpdateProgram and cleared by LoadProgram. Compiling the vertex shader
+  // fails when its outputs are used in a way the removal doesn't handle, as its hash would not match the code.
+  Status LinkEntryPoints(std::string_view vertexEntryPoint, std::string_view fragmentEntryPoint);
+  // Index of the entry point linked with the entry point, -1 when it is not linked.
+  [[nodiscard]] int64_t GetLinkedEntryPoint(int64_t entryPointIdx) const;
+
   void AddModulesSearchPath(std::string_view path) { modulesSearchPaths.emplace_back(path); }
 
-  Status Compile(int64_t entryPointIdx, int64_t targetIdx, IWriter &writer);
+  Status Compile(int64_t entryPointIdx, int64_t targetIdx, IWriter &writer, int64_t permutationIdx = 0);
+  // Same as Compile, the blob is returned with its reflection summary. Repeated calls reuse the sessions of the target.
+  CompiledShader CompileToMemory(int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx = 0);
+
+  // Compiles all jobs on up to threadCount worker threads (0 - hardware concurrency). Results are returned in jobs order,
+  // results identical to the earlier ones are marked with DuplicateOf.
+  std::vector<CompileResult> CompileAll(std::span<const CompileJob> jobs, uint32_t threadCount = 0);
 
   [[nodiscard]] inline TargetProfile GetTarget(int64_t idx) const { return targets.at(idx).Profile; }
   [[nodiscard]] inline int64_t GetTargetCount() const { return targets.size(); }
 
+  // There is always at least one permutation, the default one has no defines and constants.
+  [[nodiscard]] inline int64_t GetPermutationCount() const { return std::max<int64_t>(1, permutations.size()); }
+  [[nodiscard]] const Permutation &GetPermutation(int64_t idx) const;
+
+  // Registers of the packed uniforms of the loaded program, empty when the packing is disabled or the program has none.
+  [[nodiscard]] const UniformPacking &GetUniformPacking() const { return uniformPacking; }
+
+  // Files loaded by LoadProgram besides the program itself: imported modules and included files.
+  [[nodiscard]] const std::vector<std::string> &GetDependencies() const { return dependencies; }
+
+  // Hash of the entry point generated by slang for the target (index as in Compile), the entry point is linked and hashed on the
+  // first request.
+  // Empty when the entry point or target doesn't exist.
+  std::string_view GetEntryPointHash(int64_t entryPointIdx, int64_t targetIdx);
+
   [[nodiscard]] inline uint64_t GetEntryPointCount() const { return entryPointsSource().size(); };
   [[nodiscard]] const EntryPoint *GetEntryPointByName(std::string_view name) const;
   [[nodiscard]] const EntryPoint *GetEntryPointByIndex(int64_t idx) const;
 
 private:
   IWriter *verboseWriter = nullptr;
+  const CompileCache *cache = nullptr;
+  ModuleCache *moduleCache = nullptr;
+  GlobalSessionPool *globalSessionPool = nullptr;
+  ITraceSink *traceSink = nullptr;
   std::vector<TargetSettings> targets;
   std::vector<std::string> modulesSearchPaths;
-  Slang::ComPtr<slang::IGlobalSession> slangGlobalSession;
-  Slang::ComPtr<slang::IBlob> diagnostics;
+  std::vector<Permutation> permutations;
+  std::string packedUniformsName;
+  bool compactsUniformBuffers = false;
+  std::mutex logMutex;
 
   std::string inputCode;
   std::vector<EntryPoint> availableEntryPoints;
   std::vector<EntryPoint> selectedEntryPoints;
-
-  Status createSession(slang::ISession **outSession, int64_t entryPointIdx, int64_t targetIdx);
-
-  Status processProgram(std::string_view code, slang::IComponentType **outProgram, int64_t entryPointIdx = -1, int64_t targetIdx = -1);
+  // names of the vertex and fragment entry points linked by LinkEntryPoints
+  std::vector<std::pair<std::string, std::string>> entryPointLinks;
+  std::vector<std::string> dependencies;
+  UniformPacking uniformPacking;
+  // session and program module loaded by LoadProgram, the session is reused by UpdateProgram
+  Slang::ComPtr<slang::ISession> loadSession;
+  Slang::ComPtr<slang::IModule> loadedModule;
+  // programs with one entry point of loadedModule, linked when its hash is first requested
+  std::vector<Slang::ComPtr<slang::IComponentType>> linkedEntryPoints;
+  uint32_t programVersion = 0;
+
+  // Session with the parsed and checked program module, shared by every entry point compiled with the same target options.
+  // Permutations with the same defines share the session, PermutationIdx is the first of them.
+  struct CompileSession {
+    int64_t TargetIdx;
+    StageType Stage;
+    int64_t PermutationIdx;
+    // program version loaded in Module, older modules are replaced on the next use of the session
+    uint32_t ProgramVersion = 0;
+    Slang::ComPtr<slang::ISession> Session;
+    Slang::ComPtr<slang::IModule> Module;
+    // generated modules with permutation constants, by permutation index
+    std::vector<std::pair<int64_t, Slang::ComPtr<slang::IModule>>> ConstantModules;
+  };
+
+  // Slang sessions are not thread safe, so every worker thread gets its own global session and compile sessions.
+  // contexts[0] is used by LoadProgram and Compile.
+  struct CompileContext {
+    Slang::ComPtr<slang::IGlobalSession> GlobalSession;
+    std::vector<CompileSession> Sessions;
+  };
+  std::vector<std::unique_ptr<CompileContext>> contexts;
+
+  CompileContext &getContext(size_t idx);
+
+  Status createSession(CompileContext &context, slang::ISession **outSession, int64_t entryPointIdx, int64_t targetIdx,
+                       int64_t permutationIdx);
+  Status getCompileSession(CompileContext &context, int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx,
+                           CompileSession *&outSession, std::string &warnings);
+  Status getConstantsModule(CompileSession &compileSession, int64_t permutationIdx, slang::IModule *&outModule, std::string &warnings);
+  Status compile(CompileContext &context, int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx, IWriter &writer);
+  Status compileProgram(CompileContext &context, int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx, IWriter &writer);
+  Status getLinkedVaryings(CompileSession &compileSession, slang::IModule *constantsModule, int64_t linkedEntryPointIdx, SlangStage stage,
+                           const std::vector<Param> &params, std::vector<Param> &outVaryings, std::string &warnings);
+
+  [[nodiscard]] int64_t getSessionPermutation(int64_t permutationIdx) const;
+  void appendTargetKey(std::string &key, const TargetSettings &target, StageType stage) const;
+  void appendDefinesKey(std::string &key, int64_t permutationIdx) const;
+  [[nodiscard]] std::string getCacheKey(int64_t entryPointIdx, int64_t targetIdx, int64_t permutationIdx) const;
+  [[nodiscard]] std::string getSessionFingerprint(CompileContext &context, int64_t entryPointIdx, int64_t targetIdx,
+                                                  int64_t permutationIdx) const;
+
+  Status loadProgram(std::string_view code);
+  [[nodiscard]] std::string getProgramModuleName() const;
+  Status loadModule(slang::ISession *session, std::string_view fingerprint, std::string_view code, slang::IModule **outModule,
+                    std::string &warnings);
+  void preloadModules(slang::ISession *session, std::string_view fingerprint, std::string_view code,
+                      std::vector<std::string> &loadedModules);
+  void preloadModule(slang::ISession *session, std::string_view fingerprint, const std::string &name,
+                     std::vector<std::string> &loadedModules);
+  void storeModules(slang::ISession *session, std::string_view fingerprint, const std::vector<std::string> &loadedModules);
+  void collectDependencies(slang::ISession *session);
+  Status linkProgram(slang::ISession *session, slang::IModule *module, slang::IComponentType **outProgram, std::string &warnings,
+                     int64_t entryPointIdx = -1, slang::IModule *constantsModule = nullptr);
 
   [[nodiscard]] const std::vector<EntryPoint> &entryPointsSource() const {
     return selectedEntryPoints.empty() ? availableEntryPoints : selectedEntryPoints;
@@ -70,6 +242,7 @@ private:
 
   inline void writeLog(std::string_view message) {
     if (verboseWriter != nullptr) {
+      std::lock_guard lock(logMutex);
       verboseWriter->Write(message);
     }
   }
@@ -49,6 +49,8 @@ struct EntryPoint {
     return nullptr;
   }
 
+  // Filled by Compiler::GetEntryPointHash, empty until the hash for the target is requested or the entry point compiled with
+  // the compile cache.
   [[nodiscard]] std::string_view GetHash(TargetFormat format) const {
     for (const auto &hash : TargetHashes) {
       if (hash.Format == format) {
@@ -60,11 +62,11 @@ struct EntryPoint {
 
   [[nodiscard]] inline bool IsValid() const { return Idx >= 0; }
 
-  static EntryPoint FromSlangEntryPoint(int64_t idx, slang::EntryPointReflection *entryPoint) {
-    EntryPoint ep = {entryPoint->getName(), idx, ConvertStageType(entryPoint->getStage())};
-    auto *fun = entryPoint->getFunction();
-    for (int i = 0; i < fun->getUserAttributeCount(); ++i) {
-      ep.Attributes.push_back(UserAttribute::FromSlangAttribute(fun->getUserAttributeByIndex(i)));
+  // idx - index of the entry point defined in the module, the name and attributes come from its function
+  static EntryPoint FromSlangEntryPoint(int64_t idx, slang::FunctionReflection *function, SlangStage stage) {
+    EntryPoint ep = {function->getName(), idx, ConvertStageType(stage)};
+    for (int i = 0; i < function->getUserAttributeCount(); ++i) {
+      ep.Attributes.push_back(UserAttribute::FromSlangAttribute(function->getUserAttributeByIndex(i)));
     }
     return ep;
   }
@@ -0,0 +1,33 @@
+#include "GlobalSessionPool.h"
+#include <mutex>
+#include <slang-com-ptr.h>
+#include <slang.h>
+#include <utility>
+
+namespace BgfxSlang {
+
+Slang::ComPtr<slang::IGlobalSession> GlobalSessionPool::Acquire() {
+  {
+    std::lock_guard lock(mutex);
+    if (!idleSessions.empty()) {
+      auto session = std::move(idleSessions.back());
+      idleSessions.pop_back();
+      return session;
+    }
+  }
+
+  Slang::ComPtr<slang::IGlobalSession> session;
+  SlangGlobalSessionDesc slangGlobalSessionDesc;
+  slang::createGlobalSession(&slangGlobalSessionDesc, session.writeRef());
+  return session;
+}
+
+void GlobalSessionPool::Release(Slang::ComPtr<slang::IGlobalSession> session) {
+  if (session == nullptr) {
+    return;
+  }
+  std::lock_guard lock(mutex);
+  idleSessions.push_back(std::move(session));
+}
+
+} // namespace BgfxSlang
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <mutex>
+#include <slang-com-ptr.h>
+#include <slang.h>
+#include <vector>
+
+namespace BgfxSlang {
+
+// Slang global sessions are expensive to create (core module load) and can't be used from many threads at once.
+// The pool hands out idle sessions, so many compilers can share them one thread at a time.
+class GlobalSessionPool {
+public:
+  Slang::ComPtr<slang::IGlobalSession> Acquire();
+  void Release(Slang::ComPtr<slang::IGlobalSession> session);
+
+private:
+  std::mutex mutex;
+  std::vector<Slang::ComPtr<slang::IGlobalSession>> idleSessions;
+};
+
+} // namespace BgfxSlang
@@ -1,92 +1,29 @@
+#include "GlslRewriter.h"
+#include "SpirvPasses.h"
 #include "Status.h"
 #include "Target.h"
 #include "Types.h"
+#include "UniformPacking.h"
 #include "Utils/IWriter.h"
+#include "Utils/Trace.h"
 #include "spirv.hpp"
 #include "spirv_cross.hpp"
 #include <array>
+#include <cctype>
 #include <cstddef>
 #include <cstdint>
-#include <regex>
 #include <slang-com-ptr.h>
 #include <slang.h>
 #include <spirv_glsl.hpp>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace BgfxSlang {
 
 namespace {
 constexpr std::string_view entryPointParamPrefix = "entryPointParam_";
-
-bool consumeBalancedSquareBrackets(const std::string &s, size_t &i) {
-  if (i >= s.size() || s[i] != '[') {
-    return false;
-  }
-
-  int depth = 0;
-  while (i < s.size()) {
-    char c = s[i++];
-
-    if (c == '[') {
-      depth++;
-    } else if (c == ']') {
-      depth--;
-      if (depth == 0) {
-        return true;
-      }
-    } else if (c == '"' || c == '\'') {
-      char q = c;
-      while (i < s.size()) {
-        char d = s[i++];
-        if (d == '\\' && i < s.size()) {
-          i++;
-          continue;
-        }
-        if (d == q) {
-          break;
-        }
-      }
-    }
-  }
-  return false;
-}
-
-void consumeAnyIndexing(const std::string &s, size_t &i) {
-  while (i < s.size() && s[i] == '[') {
-    size_t tmp = i;
-    if (!consumeBalancedSquareBrackets(s, tmp)) {
-      break;
-    }
-    i = tmp;
-  }
-}
-
-bool startsWithAt(const std::string &s, size_t i, const std::string &needle) { return s.compare(i, needle.size(), needle) == 0; }
-
-void removeDataAfter(std::string &source, const std::string &bufferName, const std::string &memberName) {
-  const std::string head = bufferName + "." + memberName;
-  const std::string dataTok = ".data";
-
-  size_t pos = 0;
-  while ((pos = source.find(head, pos)) != std::string::npos) {
-    size_t i = pos + head.size();
-
-    consumeAnyIndexing(source, i);
-
-    for (int k = 0; k < 2; k++) {
-      if (!startsWithAt(source, i, dataTok)) {
-        break;
-      }
-
-      source.erase(i, dataTok.size());
-      consumeAnyIndexing(source, i);
-    }
-
-    pos = i;
-  }
-}
 } // namespace
 
 struct DefaultParam {
@@ -198,12 +135,17 @@ void processInputName(SlangStage stage, spirv_cross::CompilerGLSL &glsl, const s
 }
 
 Status writeGlslShader(Slang::ComPtr<slang::IComponentType> &linkedProgram, TargetProfile targetProfile, int64_t entryPointIdx,
-                       int64_t targetIdx, IWriter &writer, const std::vector<Param> &inputParams, std::vector<Uniform> &uniforms) {
+                       int64_t targetIdx, IWriter &writer, const std::vector<Param> &inputParams, std::vector<Uniform> &uniforms,
+                       ITraceSink *traceSink, const std::vector<std::string> *usedOutputs, const UniformPacking *packing,
+                       bool optimizesSpirv) {
   Slang::ComPtr<slang::IBlob> code;
   Slang::ComPtr<slang::IBlob> diagnostics;
-  SlangResult result = linkedProgram->getEntryPointCode(entryPointIdx, targetIdx, code.writeRef(), diagnostics.writeRef());
-  if (SLANG_FAILED(result)) {
-    return Status{StatusCode::Error, diagnostics};
+  {
+    ScopedSpan span(traceSink, "codegen");
+    SlangResult result = linkedProgram->getEntryPointCode(entryPointIdx, targetIdx, code.writeRef(), diagnostics.writeRef());
+    if (SLANG_FAILED(result)) {
+      return Status{StatusCode::Error, diagnostics};
+    }
   }
   auto *layout = linkedProgram->getLayout(targetIdx, diagnostics.writeRef());
   auto *entryPointLayout = layout->getEntryPointByIndex(entryPointIdx);
@@ -216,74 +158,103 @@ Status writeGlslShader(Slang::ComPtr<slang::IComponentType> &linkedProgram, Targ
 
   const auto version = static_cast<uint32_t>(std::stoul(std::string(targetProfile.Id.substr(5))));
 
-  spirv_cross::CompilerGLSL glsl(reinterpret_cast<const uint32_t *>(code->getBufferPointer()), code->getBufferSize() / 4);
-  spirv_cross::CompilerGLSL::Options options;
-  options.version = version;
-  options.es = targetProfile.Format == TargetFormat::OpenGLES;
-  options.emit_uniform_buffer_as_plain_uniforms = true;
-  options.enable_420pack_extension = false;
-  options.fragment.default_float_precision = spirv_cross::CompilerGLSL::Options::Precision::Highp;
-  glsl.set_common_options(options);
+  std::vector<UniformBufferRewrite> bufferRewrites;
+  std::string source;
+  {
+    ScopedSpan span(traceSink, "spirv-cross");
+    const auto *codeWords = static_cast<const uint32_t *>(code->getBufferPointer());
+    std::vector<uint32_t> spirv(codeWords, codeWords + code->getBufferSize() / sizeof(uint32_t));
+
+    // uniform buffers are lowered to plain uniforms in SPIR-V, when the pass can't handle the module they are rewritten in the
+    // generated source instead, which can't read the packed uniforms
+    if (!flattenUniformBuffers(spirv, packing) && packing != nullptr) {
+      return Status{StatusCode::Error, "Failed to pack the uniforms"};
+    }
+    // GLSL matches the varyings by name, the linked fragment shader declares only the kept ones
+    if (usedOutputs != nullptr && !removeUnusedOutputs(spirv, *usedOutputs)) {
+      return Status{StatusCode::Error, "Failed to remove the outputs the linked fragment shader doesn't read"};
+    }
+    if (optimizesSpirv) {
+      optimizeSpirv(spirv, false);
+    }
 
-  auto resources = glsl.get_shader_resources();
+    spirv_cross::CompilerGLSL glsl(std::move(spirv));
+    spirv_cross::CompilerGLSL::Options options;
+    options.version = version;
+    options.es = targetProfile.Format == TargetFormat::OpenGLES;
+    options.emit_uniform_buffer_as_plain_uniforms = true;
+    options.enable_420pack_extension = false;
+    options.fragment.default_float_precision = spirv_cross::CompilerGLSL::Options::Precision::Highp;
+    glsl.set_common_options(options);
 
-  for (auto &output : resources.stage_outputs) {
-    auto a = output.name;
-    processOutputName(stage, glsl, output);
-  }
+    auto resources = glsl.get_shader_resources();
 
-  for (auto &input : resources.stage_inputs) {
-    processInputName(stage, glsl, input, inputParams);
-  }
+    for (auto &output : resources.stage_outputs) {
+      auto a = output.name;
+      processOutputName(stage, glsl, output);
+    }
 
-  glsl.build_dummy_sampler_for_combined_images();
-  glsl.build_combined_image_samplers();
-  for (const auto &sampler : glsl.get_combined_image_samplers()) {
-    glsl.set_name(sampler.combined_id, glsl.get_name(sampler.image_id));
-  }
-  std::string source = glsl.compile();
+    for (auto &input : resources.stage_inputs) {
+      processInputName(stage, glsl, input, inputParams);
+    }
 
-  for (auto &ubo : resources.uniform_buffers) {
+    glsl.build_dummy_sampler_for_combined_images();
+    glsl.build_combined_image_samplers();
+    for (const auto &sampler : glsl.get_combined_image_samplers()) {
+      glsl.set_name(sampler.combined_id, glsl.get_name(sampler.image_id));
+    }
+    source = glsl.compile();
 
-    std::string unfiormsList;
+    bufferRewrites.reserve(resources.uniform_buffers.size());
 
-    auto bufferTypeName = ubo.name;
-    const auto &bufferName = glsl.get_name(ubo.id);
+    for (auto &ubo : resources.uniform_buffers) {
+      auto &rewrite = bufferRewrites.emplace_back();
+      rewrite.TypeName = ubo.name;
+      rewrite.Name = glsl.get_name(ubo.id);
 
-    auto type = glsl.get_type(ubo.type_id);
-    auto memberCount = type.member_types.size();
+      auto type = glsl.get_type(ubo.type_id);
+      auto memberCount = type.member_types.size();
 
-    for (int i = 0; i < memberCount; i++) {
-      const auto &memberName = glsl.get_member_name(ubo.base_type_id, i);
-      const auto uniform = getUniformByName(memberName, uniforms);
+      for (int i = 0; i < memberCount; i++) {
+        const auto &memberName = glsl.get_member_name(ubo.base_type_id, i);
+        const auto uniform = getUniformByName(memberName, uniforms);
 
-      unfiormsList += uniformDeclLine(uniform);
+        rewrite.Declarations += uniformDeclLine(uniform);
 
-      auto memberType = glsl.get_type(type.member_types[i]);
-      if (memberType.op == spv::OpTypeStruct) {
-        // remove all .data after bufferName.memberName
-        // for example globalParams.lightBuffer.data[0] to globalParams.lightBuffer[0] etc.
-        removeDataAfter(source, bufferName, memberName);
+        // for example globalParams.lightBuffer.data[0] becomes lightBuffer[0]
+        auto memberType = glsl.get_type(type.member_types[i]);
+        rewrite.Members.push_back({memberName, memberType.op == spv::OpTypeStruct});
       }
-
-      // just vec4 etc
-      std::string pattern = bufferName + "\\.";
-      pattern += memberName + "(?![A-Za-z])";
-      std::regex re(pattern);
-      const std::string &format = memberName;
-      source = std::regex_replace(source, re, format);
     }
+  }
 
-    std::string targetReplace = "uniform " + bufferTypeName + " ";
-    targetReplace += bufferName + ";\n";
-
-    source = std::regex_replace(source, std::regex(targetReplace), unfiormsList);
+  if (!bufferRewrites.empty()) {
+    ScopedSpan span(traceSink, "glsl-rewrite");
+    source = rewriteUniformBuffers(source, bufferRewrites);
   }
 
+  ScopedSpan span(traceSink, "write");
+  writer.Reserve(sizeof(uint32_t) + source.size() + sizeof(uint8_t));
   writer.Write<uint32_t>(source.size());
   writer.Write(source.data(), source.size());
   uint8_t nul = 0;
   writer.Write(nul);
   return !warnings.empty() ? Status{StatusCode::Warning, warnings} : Status{};
 }
+
+std::vector<Attrib> findGlslVertexAttributes(std::string_view source) {
+  auto isIdentifierChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_'; };
+
+  std::vector<Attrib> attributes;
+  for (const auto &param : defaultInputParamNames) {
+    for (auto pos = source.find(param.Name); pos != std::string_view::npos; pos = source.find(param.Name, pos + 1)) {
+      const auto end = pos + param.Name.size();
+      if ((pos == 0 || !isIdentifierChar(source[pos - 1])) && (end == source.size() || !isIdentifierChar(source[end]))) {
+        attributes.push_back(param.Attr);
+        break;
+      }
+    }
+  }
+  return attributes;
+}
 } // namespace BgfxSlang
\ No newline at end of file
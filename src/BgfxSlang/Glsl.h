@@ -3,14 +3,26 @@
 #include "Status.h"
 #include "Target.h"
 #include "Types.h"
+#include "UniformPacking.h"
 #include "Utils/IWriter.h"
+#include "Utils/Trace.h"
 #include <cstdint>
 #include <slang-com-ptr.h>
 #include <slang.h>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace BgfxSlang {
 
+// usedOutputs - names of the vertex outputs the linked fragment shader reads, the others are removed
+// packing - uniforms read from the packed vec4 array uniform
+// optimizesSpirv - optimizeSpirv is run before SPIRV-Cross, keeping the names
 Status writeGlslShader(Slang::ComPtr<slang::IComponentType> &linkedProgram, TargetProfile targetProfile, int64_t entryPointIdx,
-                       int64_t targetIdx, IWriter &writer, const std::vector<Param> &inputParams, std::vector<Uniform> &uniforms);
+                       int64_t targetIdx, IWriter &writer, const std::vector<Param> &inputParams, std::vector<Uniform> &uniforms,
+                       ITraceSink *traceSink = nullptr, const std::vector<std::string> *usedOutputs = nullptr,
+                       const UniformPacking *packing = nullptr, bool optimizesSpirv = false);
+
+// Vertex attributes declared in the GLSL code written by writeGlslShader, found by their bgfx names (a_position, a_texcoord0...).
+std::vector<Attrib> findGlslVertexAttributes(std::string_view source);
 }
\ No newline at end of file
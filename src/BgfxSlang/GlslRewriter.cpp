@@ -0,0 +1,167 @@
+#include "GlslRewriter.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BgfxSlang {
+
+namespace {
+constexpr std::string_view uniformKeyword = "uniform";
+constexpr std::string_view dataMember = "data";
+constexpr int maxDataAccesses = 2;
+
+inline bool isIdentifierStart(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+inline bool isIdentifierChar(char c) { return isIdentifierStart(c) || (c >= '0' && c <= '9'); }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+std::string_view readIdentifier(std::string_view source, size_t pos) {
+  size_t end = pos;
+  while (end < source.size() && isIdentifierChar(source[end])) {
+    end++;
+  }
+  return source.substr(pos, end - pos);
+}
+
+size_t skipBlanks(std::string_view source, size_t pos) {
+  while (pos < source.size() && isBlank(source[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+// Matches "uniform TypeName Name;\n" starting at pos, returns position after it or 0.
+size_t matchDeclaration(std::string_view source, size_t pos, const UniformBufferRewrite &buffer) {
+  pos = skipBlanks(source, pos + uniformKeyword.size());
+  if (readIdentifier(source, pos) != buffer.TypeName) {
+    return 0;
+  }
+  pos = skipBlanks(source, pos + buffer.TypeName.size());
+  if (readIdentifier(source, pos) != buffer.Name) {
+    return 0;
+  }
+  pos = skipBlanks(source, pos + buffer.Name.size());
+  if (pos >= source.size() || source[pos] != ';') {
+    return 0;
+  }
+  pos++;
+  if (pos < source.size() && source[pos] == '\n') {
+    pos++;
+  }
+  return pos;
+}
+
+struct BufferLookup {
+  const UniformBufferRewrite *Buffer;
+  std::unordered_map<std::string_view, bool> Members;
+};
+
+// Pending removal of ".data" after struct member, valid as long as only indexing follows the member at the same bracket depth.
+struct DataStrip {
+  int Depth;
+  int Remaining;
+};
+} // namespace
+
+std::string rewriteUniformBuffers(std::string_view source, std::span<const UniformBufferRewrite> buffers) {
+  std::unordered_map<std::string_view, BufferLookup> bufferByName;
+  std::unordered_map<std::string_view, const UniformBufferRewrite *> bufferByTypeName;
+  for (const auto &buffer : buffers) {
+    auto &lookup = bufferByName[buffer.Name];
+    lookup.Buffer = &buffer;
+    for (const auto &member : buffer.Members) {
+      lookup.Members.emplace(member.Name, member.IsStruct);
+    }
+    bufferByTypeName.emplace(buffer.TypeName, &buffer);
+  }
+
+  std::string result;
+  result.reserve(source.size());
+
+  std::vector<DataStrip> dataStrips;
+  int depth = 0;
+  size_t pos = 0;
+
+  while (pos < source.size()) {
+    char c = source[pos];
+
+    if (!dataStrips.empty() && dataStrips.back().Depth == depth && c != '[') {
+      auto &strip = dataStrips.back();
+      if (c == '.' && strip.Remaining > 0 && readIdentifier(source, pos + 1) == dataMember) {
+        strip.Remaining--;
+        pos += 1 + dataMember.size();
+        continue;
+      }
+      dataStrips.pop_back();
+      continue;
+    }
+
+    if (c == '[') {
+      depth++;
+    } else if (c == ']') {
+      depth--;
+    }
+
+    if (isDigit(c)) {
+      // numeric literals may contain letters (1.0e5, 2u), they are never identifiers
+      size_t end = pos;
+      while (end < source.size() && (isIdentifierChar(source[end]) || source[end] == '.')) {
+        end++;
+      }
+      result.append(source.substr(pos, end - pos));
+      pos = end;
+      continue;
+    }
+
+    if (!isIdentifierStart(c)) {
+      result.push_back(c);
+      pos++;
+      continue;
+    }
+
+    auto identifier = readIdentifier(source, pos);
+    bool isMemberAccess = pos > 0 && source[pos - 1] == '.';
+
+    if (!isMemberAccess && identifier == uniformKeyword) {
+      bool replaced = false;
+      auto typePos = skipBlanks(source, pos + identifier.size());
+      if (auto it = bufferByTypeName.find(readIdentifier(source, typePos)); it != bufferByTypeName.end()) {
+        if (auto end = matchDeclaration(source, pos, *it->second); end != 0) {
+          result.append(it->second->Declarations);
+          pos = end;
+          replaced = true;
+        }
+      }
+      if (replaced) {
+        continue;
+      }
+    }
+
+    if (!isMemberAccess) {
+      auto bufferIt = bufferByName.find(identifier);
+      size_t memberPos = pos + identifier.size() + 1;
+      if (bufferIt != bufferByName.end() && memberPos < source.size() && source[memberPos - 1] == '.') {
+        auto member = readIdentifier(source, memberPos);
+        if (auto memberIt = bufferIt->second.Members.find(member); memberIt != bufferIt->second.Members.end()) {
+          result.append(member);
+          pos = memberPos + member.size();
+          if (memberIt->second) {
+            dataStrips.push_back({depth, maxDataAccesses});
+          }
+          continue;
+        }
+      }
+    }
+
+    result.append(identifier);
+    pos += identifier.size();
+  }
+
+  return result;
+}
+
+} // namespace BgfxSlang
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlang {
+
+struct UniformBufferMember {
+  std::string Name;
+  // struct members are std140 wrappers, their .data accesses are removed (buffer.member[0].data -> member[0])
+  bool IsStruct = false;
+};
+
+struct UniformBufferRewrite {
+  std::string TypeName;
+  std::string Name;
+  std::vector<UniformBufferMember> Members;
+  // plain uniforms declarations replacing "uniform TypeName Name;" line
+  std::string Declarations;
+};
+
+// Turns uniform buffers emitted by SPIRV-Cross into plain uniforms expected by bgfx, in a single pass over the source:
+// - "uniform TypeName Name;" declarations are replaced with the buffer Declarations
+// - "Name.member" accesses are replaced with "member"
+std::string rewriteUniformBuffers(std::string_view source, std::span<const UniformBufferRewrite> buffers);
+
+} // namespace BgfxSlang
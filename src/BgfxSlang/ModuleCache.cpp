@@ -0,0 +1,176 @@
+#include "ModuleCache.h"
+#include "Utils/MemoryBlob.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace BgfxSlang {
+
+namespace {
+constexpr std::string_view importKeyword = "import";
+
+inline bool isIdentifierStart(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+inline bool isIdentifierChar(char c) { return isIdentifierStart(c) || (c >= '0' && c <= '9'); }
+inline bool isWhitespace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+std::string getKey(std::string_view fingerprint, std::string_view moduleName) {
+  std::string key = "module;";
+  key += fingerprint;
+  key += ";";
+  key += moduleName;
+  return key;
+}
+
+void appendU32(std::vector<uint8_t> &data, uint32_t value) {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+  data.insert(data.end(), bytes, bytes + sizeof(value));
+}
+
+void appendString(std::vector<uint8_t> &data, std::string_view str) {
+  appendU32(data, static_cast<uint32_t>(str.size()));
+  data.insert(data.end(), str.begin(), str.end());
+}
+
+bool readU32(std::span<const uint8_t> &data, uint32_t &value) {
+  if (data.size() < sizeof(value)) {
+    return false;
+  }
+  std::memcpy(&value, data.data(), sizeof(value));
+  data = data.subspan(sizeof(value));
+  return true;
+}
+
+bool readString(std::span<const uint8_t> &data, std::string &str) {
+  uint32_t size = 0;
+  if (!readU32(data, size) || data.size() < size) {
+    return false;
+  }
+  str.assign(reinterpret_cast<const char *>(data.data()), size);
+  data = data.subspan(size);
+  return true;
+}
+
+// disk entry: path, imports and serialized module
+std::vector<uint8_t> serializeEntry(const ModuleCache::Entry &entry) {
+  std::vector<uint8_t> data;
+  appendString(data, entry.Path);
+  appendU32(data, static_cast<uint32_t>(entry.Imports.size()));
+  for (const auto &import : entry.Imports) {
+    appendString(data, import);
+  }
+  const auto *blob = static_cast<const uint8_t *>(entry.Blob->getBufferPointer());
+  data.insert(data.end(), blob, blob + entry.Blob->getBufferSize());
+  return data;
+}
+
+bool deserializeEntry(std::span<const uint8_t> data, ModuleCache::Entry &entry) {
+  uint32_t importCount = 0;
+  if (!readString(data, entry.Path) || !readU32(data, importCount) || importCount > data.size()) {
+    return false;
+  }
+  entry.Imports.resize(importCount);
+  for (auto &import : entry.Imports) {
+    if (!readString(data, import)) {
+      return false;
+    }
+  }
+  entry.Blob = MemoryBlob::Create(std::vector<uint8_t>(data.begin(), data.end()));
+  return true;
+}
+} // namespace
+
+std::shared_ptr<const ModuleCache::Entry> ModuleCache::Find(std::string_view fingerprint, std::string_view moduleName) {
+  auto key = getKey(fingerprint, moduleName);
+  {
+    std::lock_guard lock(mutex);
+    if (auto it = entries.find(key); it != entries.end()) {
+      return it->second;
+    }
+  }
+
+  std::vector<uint8_t> data;
+  if (diskCache == nullptr || !diskCache->Load(key, data)) {
+    return nullptr;
+  }
+
+  auto entry = std::make_shared<Entry>();
+  if (!deserializeEntry(data, *entry)) {
+    return nullptr;
+  }
+
+  std::lock_guard lock(mutex);
+  return entries.try_emplace(std::move(key), std::move(entry)).first->second;
+}
+
+void ModuleCache::Store(std::string_view fingerprint, std::string_view moduleName, Entry entry) {
+  auto key = getKey(fingerprint, moduleName);
+  if (diskCache != nullptr) {
+    diskCache->Store(key, serializeEntry(entry));
+  }
+
+  std::lock_guard lock(mutex);
+  entries.insert_or_assign(std::move(key), std::make_shared<const Entry>(std::move(entry)));
+}
+
+std::vector<std::string> ModuleCache::FindImports(std::string_view source) {
+  std::vector<std::string> imports;
+
+  size_t pos = 0;
+  while (pos < source.size()) {
+    const char c = source[pos];
+
+    if (source.substr(pos, 2) == "//") {
+      pos = source.find('\n', pos);
+      continue;
+    }
+    if (source.substr(pos, 2) == "/*") {
+      pos = source.find("*/", pos + 2);
+      pos = pos == std::string_view::npos ? pos : pos + 2;
+      continue;
+    }
+    if (c == '"') {
+      for (pos++; pos < source.size() && source[pos] != '"' && source[pos] != '\n'; pos++) {
+        pos += source[pos] == '\\' ? 1 : 0;
+      }
+      pos++;
+      continue;
+    }
+    if (!isIdentifierStart(c)) {
+      pos++;
+      continue;
+    }
+
+    size_t end = pos;
+    while (end < source.size() && isIdentifierChar(source[end])) {
+      end++;
+    }
+    const auto identifier = source.substr(pos, end - pos);
+    pos = end;
+    if (identifier != importKeyword) {
+      continue;
+    }
+
+    // dotted module name terminated with ';', string imports of files are not modules that can be cached by name
+    std::string name;
+    while (pos < source.size() && (isWhitespace(source[pos]) || isIdentifierChar(source[pos]) || source[pos] == '.')) {
+      if (!isWhitespace(source[pos])) {
+        name += source[pos];
+      }
+      pos++;
+    }
+    if (pos < source.size() && source[pos] == ';' && !name.empty()) {
+      imports.push_back(std::move(name));
+    }
+  }
+
+  return imports;
+}
+
+} // namespace BgfxSlang
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CompileCache.h"
+#include <memory>
+#include <mutex>
+#include <slang-com-ptr.h>
+#include <slang.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BgfxSlang {
+
+// Serialized slang IR of imported modules, so sessions load them as binary modules instead of parsing and checking the sources
+// again. Entries are kept in memory and, when the compile cache is set, on disk.
+// Entries are keyed by the session fingerprint (slang version, targets, options, macros and search paths) and the module name,
+// the module sources are verified with ISession::isBinaryModuleUpToDate before use.
+class ModuleCache {
+public:
+  struct Entry {
+    std::string Path;
+    std::vector<std::string> Imports;
+    Slang::ComPtr<ISlangBlob> Blob;
+  };
+
+  explicit ModuleCache(const CompileCache *diskCache = nullptr) : diskCache(diskCache) {}
+
+  std::shared_ptr<const Entry> Find(std::string_view fingerprint, std::string_view moduleName);
+  void Store(std::string_view fingerprint, std::string_view moduleName, Entry entry);
+
+  // Names of the modules imported with "import name;" statements.
+  static std::vector<std::string> FindImports(std::string_view source);
+
+private:
+  const CompileCache *diskCache;
+  std::mutex mutex;
+  std::unordered_map<std::string, std::shared_ptr<const Entry>> entries;
+};
+
+} // namespace BgfxSlang
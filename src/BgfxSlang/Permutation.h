@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace BgfxSlang {
+
+struct PermutationDefine {
+  std::string Name;
+  std::string Value = "1";
+};
+
+// Link-time constant, the shader declares it as "extern static const Type Name;"
+struct PermutationConstant {
+  std::string Type;
+  std::string Name;
+  std::string Value;
+};
+
+// Shader variant. Permutations with different defines are parsed in separate sessions, permutations that differ only in the
+// constants share the parsed module and are specialized at link time.
+struct Permutation {
+  std::vector<PermutationDefine> Defines;
+  std::vector<PermutationConstant> Constants;
+
+  [[nodiscard]] bool HasSameDefines(const Permutation &other) const {
+    if (Defines.size() != other.Defines.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < Defines.size(); i++) {
+      if (Defines[i].Name != other.Defines[i].Name || Defines[i].Value != other.Defines[i].Value) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // "export static const" declarations of the constants, linked with the program module
+  [[nodiscard]] std::string GetConstantsSource() const {
+    std::string source;
+    for (const auto &constant : Constants) {
+      source += "export static const " + constant.Type + " " + constant.Name + " = " + constant.Value + ";\n";
+    }
+    return source;
+  }
+};
+
+} // namespace BgfxSlang
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "Utils/Hash.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <string_view>
+
+namespace BgfxSlang {
+
+// Binding tables of the shaders compiled from one program (input file) for one target and permutation, written by
+// ProgramBindingsWriter (bgfx-slang-cmd --bindings). The runtime can bind the materials without any string work: uniforms are found
+// by the FNV-1a hash of their name (computed at compile time with fnv1a32) through a perfect hash table.
+// Little endian layout:
+// - ProgramBindingsHeader with the offsets and sizes of the sections
+// - sections aligned to 16 bytes, every section is an array with one value per shader, uniform or hash table slot
+// The reader doesn't depend on slang and doesn't copy anything, the file can be memory mapped.
+constexpr uint32_t programBindingsMagic = 'B' | ('S' << 8) | ('P' << 16) | ('B' << 24);
+constexpr uint32_t programBindingsVersion = 1;
+constexpr uint32_t programBindingsAlignment = 16;
+constexpr uint16_t programBindingsNoSlot = UINT16_MAX;
+constexpr uint16_t programBindingsNoTextureStage = UINT16_MAX;
+
+enum class ProgramBindingsSection : uint32_t {
+  // nul terminated names referenced by ShaderNames and UniformNames
+  Strings,
+  // ProgramBindingsString per shader
+  ShaderNames,
+  // uint8_t StageType per shader
+  ShaderStages,
+  // uint32_t per shader, bit per vertex attribute (bgfx::Attrib::Enum order) the vertex shader reads
+  ShaderAttributeMasks,
+  // uint32_t per shader, first index in ShaderUniforms
+  ShaderUniformsFirst,
+  // uint32_t per shader, count of the uniform indices in ShaderUniforms
+  ShaderUniformsCount,
+  // uint16_t indices of the uniforms used by the shaders
+  ShaderUniforms,
+  // uint32_t fnv1a32 of the name per uniform
+  UniformNameHashes,
+  // ProgramBindingsString per uniform
+  UniformNames,
+  // uint8_t UniformType per uniform
+  UniformTypes,
+  // uint16_t array size per uniform
+  UniformCounts,
+  // uint16_t texture stage per uniform, programBindingsNoTextureStage for the uniforms other than samplers
+  UniformTextureStages,
+  // uint32_t seed per hash table bucket
+  HashSeeds,
+  // uint16_t uniform index per hash table slot, programBindingsNoSlot for the empty slots
+  HashSlots,
+
+  Count
+};
+
+struct ProgramBindingsRange {
+  uint32_t Offset;
+  uint32_t Size;
+};
+
+struct ProgramBindingsHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t ShaderCount;
+  uint32_t UniformCount;
+  uint32_t ShaderUniformCount;
+  uint32_t SeedCount;
+  // power of two
+  uint32_t SlotCount;
+  uint32_t Reserved;
+  ProgramBindingsRange Sections[static_cast<size_t>(ProgramBindingsSection::Count)];
+};
+
+// offset in the string table and size without the nul terminator
+struct ProgramBindingsString {
+  uint32_t Offset;
+  uint32_t Size;
+};
+
+static_assert(sizeof(ProgramBindingsHeader) == 144);
+
+// Slot of the name hash in the hash table, the bucket seed makes the slots of all the uniforms distinct.
+constexpr uint32_t programBindingsSlot(uint32_t nameHash, uint32_t seed, uint32_t slotCount) {
+  uint32_t hash = nameHash ^ seed;
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bU;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35U;
+  hash ^= hash >> 16;
+  return hash & (slotCount - 1);
+}
+
+class ProgramBindings {
+public:
+  // The data must stay valid while the bindings are used and be aligned to 4 bytes. Returns false when the data is not valid.
+  bool Open(std::span<const uint8_t> bindingsData) {
+    data = {};
+    if (bindingsData.size() < sizeof(header) || reinterpret_cast<uintptr_t>(bindingsData.data()) % alignof(uint32_t) != 0) {
+      return false;
+    }
+    std::memcpy(&header, bindingsData.data(), sizeof(header));
+    if (header.Magic != programBindingsMagic || header.Version != programBindingsVersion || header.SeedCount == 0 ||
+        header.SlotCount == 0 || (header.SlotCount & (header.SlotCount - 1)) != 0) {
+      return false;
+    }
+
+    const size_t shaders = header.ShaderCount;
+    const size_t uniforms = header.UniformCount;
+    const size_t expectedSizes[] = {
+        0,
+        shaders * sizeof(ProgramBindingsString),
+        shaders * sizeof(uint8_t),
+        shaders * sizeof(uint32_t),
+        shaders * sizeof(uint32_t),
+        shaders * sizeof(uint32_t),
+        header.ShaderUniformCount * sizeof(uint16_t),
+        uniforms * sizeof(uint32_t),
+        uniforms * sizeof(ProgramBindingsString),
+        uniforms * sizeof(uint8_t),
+        uniforms * sizeof(uint16_t),
+        uniforms * sizeof(uint16_t),
+        header.SeedCount * sizeof(uint32_t),
+        header.SlotCount * sizeof(uint16_t),
+    };
+    static_assert(std::size(expectedSizes) == static_cast<size_t>(ProgramBindingsSection::Count));
+    for (size_t i = 0; i < std::size(expectedSizes); i++) {
+      const auto &section = header.Sections[i];
+      const bool isStrings = i == static_cast<size_t>(ProgramBindingsSection::Strings);
+      if (section.Offset % programBindingsAlignment != 0 || (!isStrings && section.Size != expectedSizes[i]) ||
+          section.Offset > bindingsData.size() || section.Size > bindingsData.size() - section.Offset) {
+        return false;
+      }
+    }
+
+    data = bindingsData;
+    // validated once, so the lookups don't need to check the indices
+    for (size_t i = 0; i < shaders; i++) {
+      const uint64_t end = static_cast<uint64_t>(getArray<uint32_t>(ProgramBindingsSection::ShaderUniformsFirst)[i]) +
+                           getArray<uint32_t>(ProgramBindingsSection::ShaderUniformsCount)[i];
+      if (!isValidString(getArray<ProgramBindingsString>(ProgramBindingsSection::ShaderNames)[i]) || end > header.ShaderUniformCount) {
+        data = {};
+        return false;
+      }
+    }
+    for (const auto uniformIdx : getShaderUniformIndices()) {
+      if (uniformIdx >= uniforms) {
+        data = {};
+        return false;
+      }
+    }
+    for (size_t i = 0; i < uniforms; i++) {
+      if (!isValidString(getArray<ProgramBindingsString>(ProgramBindingsSection::UniformNames)[i])) {
+        data = {};
+        return false;
+      }
+    }
+    for (const auto slot : getArray<uint16_t>(ProgramBindingsSection::HashSlots)) {
+      if (slot != programBindingsNoSlot && slot >= uniforms) {
+        data = {};
+        return false;
+      }
+    }
+    return true;
+  }
+
+  [[nodiscard]] size_t GetShaderCount() const { return data.empty() ? 0 : header.ShaderCount; }
+  [[nodiscard]] size_t GetUniformCount() const { return data.empty() ? 0 : header.UniformCount; }
+
+  // Entry point name.
+  [[nodiscard]] std::string_view GetShaderName(size_t shaderIdx) const {
+    return getString(getArray<ProgramBindingsString>(ProgramBindingsSection::ShaderNames)[shaderIdx]);
+  }
+  // StageType value of the shader.
+  [[nodiscard]] uint8_t GetShaderStage(size_t shaderIdx) const {
+    return getArray<uint8_t>(ProgramBindingsSection::ShaderStages)[shaderIdx];
+  }
+  // Bit per bgfx::Attrib::Enum, for example to check the vertex layout with (mask & (1 << bgfx::Attrib::Normal)).
+  [[nodiscard]] uint32_t GetShaderAttributeMask(size_t shaderIdx) const {
+    return getArray<uint32_t>(ProgramBindingsSection::ShaderAttributeMasks)[shaderIdx];
+  }
+  // Indices of the uniforms the shader uses.
+  [[nodiscard]] std::span<const uint16_t> GetShaderUniforms(size_t shaderIdx) const {
+    return getShaderUniformIndices().subspan(getArray<uint32_t>(ProgramBindingsSection::ShaderUniformsFirst)[shaderIdx],
+                                             getArray<uint32_t>(ProgramBindingsSection::ShaderUniformsCount)[shaderIdx]);
+  }
+
+  // Arrays with one value per uniform, the types are UniformType values.
+  [[nodiscard]] std::span<const uint32_t> GetUniformNameHashes() const {
+    return getArray<uint32_t>(ProgramBindingsSection::UniformNameHashes);
+  }
+  [[nodiscard]] std::span<const uint8_t> GetUniformTypes() const { return getArray<uint8_t>(ProgramBindingsSection::UniformTypes); }
+  [[nodiscard]] std::span<const uint16_t> GetUniformCounts() const { return getArray<uint16_t>(ProgramBindingsSection::UniformCounts); }
+  [[nodiscard]] std::span<const uint16_t> GetUniformTextureStages() const {
+    return getArray<uint16_t>(ProgramBindingsSection::UniformTextureStages);
+  }
+  [[nodiscard]] std::string_view GetUniformName(size_t uniformIdx) const {
+    return getString(getArray<ProgramBindingsString>(ProgramBindingsSection::UniformNames)[uniformIdx]);
+  }
+
+  // Index of the uniform with the name hash (fnv1a32 of the name), -1 when the program has no such uniform.
+  [[nodiscard]] int32_t FindUniform(uint32_t nameHash) const {
+    if (data.empty()) {
+      return -1;
+    }
+    const auto seed = getArray<uint32_t>(ProgramBindingsSection::HashSeeds)[nameHash % header.SeedCount];
+    const auto slot = getArray<uint16_t>(ProgramBindingsSection::HashSlots)[programBindingsSlot(nameHash, seed, header.SlotCount)];
+    return slot != programBindingsNoSlot && GetUniformNameHashes()[slot] == nameHash ? slot : -1;
+  }
+
+  [[nodiscard]] int32_t FindUniform(std::string_view name) const { return FindUniform(fnv1a32(name)); }
+
+private:
+  std::span<const uint8_t> data;
+  ProgramBindingsHeader header = {};
+
+  [[nodiscard]] std::span<const uint16_t> getShaderUniformIndices() const {
+    return getArray<uint16_t>(ProgramBindingsSection::ShaderUniforms);
+  }
+
+  // sections are aligned within the data, which is aligned to 4 bytes, so the arrays are read in place
+  template <typename T> [[nodiscard]] std::span<const T> getArray(ProgramBindingsSection section) const {
+    if (data.empty()) {
+      return {};
+    }
+    const auto &range = header.Sections[static_cast<size_t>(section)];
+    return {reinterpret_cast<const T *>(data.data() + range.Offset), range.Size / sizeof(T)};
+  }
+
+  [[nodiscard]] bool isValidString(const ProgramBindingsString &str) const {
+    const auto strings = getArray<char>(ProgramBindingsSection::Strings);
+    return str.Offset <= strings.size() && str.Size < strings.size() - str.Offset && strings[str.Offset + str.Size] == '\0';
+  }
+
+  [[nodiscard]] std::string_view getString(const ProgramBindingsString &str) const {
+    return {getArray<char>(ProgramBindingsSection::Strings).data() + str.Offset, str.Size};
+  }
+};
+
+} // namespace BgfxSlang
@@ -0,0 +1,207 @@
+#include "ProgramBindingsWriter.h"
+#include "ProgramBindings.h"
+#include "Status.h"
+#include "Types.h"
+#include "Utils/Hash.h"
+#include "Utils/IWriter.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlang {
+
+namespace {
+constexpr size_t uniformsPerBucket = 4;
+constexpr uint32_t maxSeedAttempts = 1U << 20;
+
+constexpr size_t alignSection(size_t offset) {
+  return (offset + programBindingsAlignment - 1) & ~size_t{programBindingsAlignment - 1};
+}
+
+// Hash and displace: the buckets, largest first, get the first seed that puts all their uniforms to free slots. With the table
+// at most half full a seed is found after a few attempts.
+bool buildHashTable(const std::vector<uint32_t> &hashes, std::vector<uint32_t> &seeds, std::vector<uint16_t> &slots) {
+  seeds.assign(std::max<size_t>(1, (hashes.size() + uniformsPerBucket - 1) / uniformsPerBucket), 0);
+  size_t slotCount = 1;
+  while (slotCount < hashes.size() * 2) {
+    slotCount *= 2;
+  }
+  slots.assign(slotCount, programBindingsNoSlot);
+
+  std::vector<std::vector<uint16_t>> buckets(seeds.size());
+  for (size_t i = 0; i < hashes.size(); i++) {
+    buckets[hashes[i] % seeds.size()].push_back(static_cast<uint16_t>(i));
+  }
+  std::vector<size_t> order(buckets.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+  std::vector<uint32_t> bucketSlots;
+  for (const auto bucketIdx : order) {
+    const auto &bucket = buckets[bucketIdx];
+    bool placed = bucket.empty();
+    for (uint32_t seed = 0; seed < maxSeedAttempts && !placed; seed++) {
+      bucketSlots.clear();
+      placed = true;
+      for (const auto uniformIdx : bucket) {
+        const auto slot = programBindingsSlot(hashes[uniformIdx], seed, static_cast<uint32_t>(slotCount));
+        if (slots[slot] != programBindingsNoSlot || std::ranges::find(bucketSlots, slot) != bucketSlots.end()) {
+          placed = false;
+          break;
+        }
+        bucketSlots.push_back(slot);
+      }
+      if (placed) {
+        seeds[bucketIdx] = seed;
+        for (size_t i = 0; i < bucket.size(); i++) {
+          slots[bucketSlots[i]] = bucket[i];
+        }
+      }
+    }
+    if (!placed) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Section data appended at aligned offsets.
+class SectionsBuilder {
+public:
+  explicit SectionsBuilder(ProgramBindingsHeader &header) : header(header), data(alignSection(sizeof(ProgramBindingsHeader))) {}
+
+  template <typename T> void Add(ProgramBindingsSection section, const std::vector<T> &values) {
+    const auto offset = alignSection(data.size());
+    const auto *bytes = reinterpret_cast<const uint8_t *>(values.data());
+    data.resize(offset);
+    data.insert(data.end(), bytes, bytes + values.size() * sizeof(T));
+    header.Sections[static_cast<size_t>(section)] = {static_cast<uint32_t>(offset), static_cast<uint32_t>(values.size() * sizeof(T))};
+  }
+
+  [[nodiscard]] const std::vector<uint8_t> &GetData() const { return data; }
+
+private:
+  ProgramBindingsHeader &header;
+  std::vector<uint8_t> data;
+};
+} // namespace
+
+void ProgramBindingsWriter::AddShader(std::string_view name, StageType stage, std::span<const Attrib> attributes,
+                                      std::span<const Uniform> shaderUniforms) {
+  auto &shader = shaders.emplace_back(Shader{std::string(name), stage, 0, {}});
+  for (const auto attribute : attributes) {
+    if (attribute < Attrib::Unknown) {
+      shader.AttributeMask |= 1U << static_cast<uint32_t>(attribute);
+    }
+  }
+
+  for (const auto &uniform : shaderUniforms) {
+    auto [it, inserted] = uniformsByName.try_emplace(uniform.Name, static_cast<uint16_t>(uniforms.size()));
+    if (inserted) {
+      const auto textureStage = uniform.Type == UniformType::Sampler ? uniform.RegIndex : programBindingsNoTextureStage;
+      uniforms.push_back({uniform.Name, fnv1a32(uniform.Name), uniform.Type, uniform.Count, textureStage});
+    }
+    shader.Uniforms.push_back(it->second);
+  }
+}
+
+Status ProgramBindingsWriter::Write(IWriter &writer) const {
+  if (uniforms.size() >= programBindingsNoSlot) {
+    return Status{StatusCode::Error, "Program has too many uniforms for the bindings"};
+  }
+
+  std::vector<uint32_t> nameHashes;
+  for (const auto &uniform : uniforms) {
+    nameHashes.push_back(uniform.NameHash);
+  }
+  std::vector<uint32_t> sortedHashes = nameHashes;
+  std::sort(sortedHashes.begin(), sortedHashes.end());
+  if (const auto duplicate = std::adjacent_find(sortedHashes.begin(), sortedHashes.end()); duplicate != sortedHashes.end()) {
+    std::string names;
+    for (const auto &uniform : uniforms) {
+      if (uniform.NameHash == *duplicate) {
+        names += names.empty() ? uniform.Name : ", " + uniform.Name;
+      }
+    }
+    return Status{StatusCode::Error, "Uniform names have the same hash: " + names};
+  }
+
+  std::vector<uint32_t> seeds;
+  std::vector<uint16_t> slots;
+  if (!buildHashTable(nameHashes, seeds, slots)) {
+    return Status{StatusCode::Error, "Failed to build uniform hash table"};
+  }
+
+  std::vector<char> strings;
+  auto addString = [&](std::string_view str) {
+    const ProgramBindingsString result{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size())};
+    strings.insert(strings.end(), str.begin(), str.end());
+    strings.push_back('\0');
+    return result;
+  };
+
+  std::vector<ProgramBindingsString> shaderNames;
+  std::vector<uint8_t> shaderStages;
+  std::vector<uint32_t> shaderAttributeMasks;
+  std::vector<uint32_t> shaderUniformsFirst;
+  std::vector<uint32_t> shaderUniformsCount;
+  std::vector<uint16_t> shaderUniforms;
+  for (const auto &shader : shaders) {
+    shaderNames.push_back(addString(shader.Name));
+    shaderStages.push_back(static_cast<uint8_t>(shader.Stage));
+    shaderAttributeMasks.push_back(shader.AttributeMask);
+    shaderUniformsFirst.push_back(static_cast<uint32_t>(shaderUniforms.size()));
+    shaderUniformsCount.push_back(static_cast<uint32_t>(shader.Uniforms.size()));
+    shaderUniforms.insert(shaderUniforms.end(), shader.Uniforms.begin(), shader.Uniforms.end());
+  }
+
+  std::vector<ProgramBindingsString> uniformNames;
+  std::vector<uint8_t> uniformTypes;
+  std::vector<uint16_t> uniformCounts;
+  std::vector<uint16_t> uniformTextureStages;
+  for (const auto &uniform : uniforms) {
+    uniformNames.push_back(addString(uniform.Name));
+    uniformTypes.push_back(static_cast<uint8_t>(uniform.Type));
+    uniformCounts.push_back(uniform.Count);
+    uniformTextureStages.push_back(uniform.TextureStage);
+  }
+
+  ProgramBindingsHeader header = {};
+  header.Magic = programBindingsMagic;
+  header.Version = programBindingsVersion;
+  header.ShaderCount = static_cast<uint32_t>(shaders.size());
+  header.UniformCount = static_cast<uint32_t>(uniforms.size());
+  header.ShaderUniformCount = static_cast<uint32_t>(shaderUniforms.size());
+  header.SeedCount = static_cast<uint32_t>(seeds.size());
+  header.SlotCount = static_cast<uint32_t>(slots.size());
+
+  SectionsBuilder sections(header);
+  sections.Add(ProgramBindingsSection::Strings, strings);
+  sections.Add(ProgramBindingsSection::ShaderNames, shaderNames);
+  sections.Add(ProgramBindingsSection::ShaderStages, shaderStages);
+  sections.Add(ProgramBindingsSection::ShaderAttributeMasks, shaderAttributeMasks);
+  sections.Add(ProgramBindingsSection::ShaderUniformsFirst, shaderUniformsFirst);
+  sections.Add(ProgramBindingsSection::ShaderUniformsCount, shaderUniformsCount);
+  sections.Add(ProgramBindingsSection::ShaderUniforms, shaderUniforms);
+  sections.Add(ProgramBindingsSection::UniformNameHashes, nameHashes);
+  sections.Add(ProgramBindingsSection::UniformNames, uniformNames);
+  sections.Add(ProgramBindingsSection::UniformTypes, uniformTypes);
+  sections.Add(ProgramBindingsSection::UniformCounts, uniformCounts);
+  sections.Add(ProgramBindingsSection::UniformTextureStages, uniformTextureStages);
+  sections.Add(ProgramBindingsSection::HashSeeds, seeds);
+  sections.Add(ProgramBindingsSection::HashSlots, slots);
+
+  // the header is complete only after all the sections were added
+  const auto &data = sections.GetData();
+  writer.Reserve(data.size());
+  writer.Write(header);
+  writer.Write(data.data() + sizeof(header), data.size() - sizeof(header));
+  return Status{};
+}
+
+} // namespace BgfxSlang
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ProgramBindings.h"
+#include "Status.h"
+#include "Types.h"
+#include "Utils/IWriter.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BgfxSlang {
+
+// Builds ProgramBindings from the reflection of the compiled shaders. Uniforms used by many shaders are stored once, the first
+// shader using a sampler gives its texture stage.
+class ProgramBindingsWriter {
+public:
+  void AddShader(std::string_view name, StageType stage, std::span<const Attrib> attributes, std::span<const Uniform> uniforms);
+
+  // Fails when two uniform names have the same hash.
+  Status Write(IWriter &writer) const;
+
+  [[nodiscard]] size_t GetShaderCount() const { return shaders.size(); }
+
+private:
+  struct Shader {
+    std::string Name;
+    StageType Stage;
+    uint32_t AttributeMask;
+    std::vector<uint16_t> Uniforms;
+  };
+
+  struct BindingUniform {
+    std::string Name;
+    uint32_t NameHash;
+    UniformType Type;
+    uint16_t Count;
+    uint16_t TextureStage;
+  };
+
+  std::vector<Shader> shaders;
+  std::vector<BindingUniform> uniforms;
+  std::unordered_map<std::string, uint16_t> uniformsByName;
+};
+
+} // namespace BgfxSlang
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+#ifdef BGFXSLANG_ZSTD
+#include <memory>
+#include <zstd.h>
+#endif
+
+namespace BgfxSlang {
+
+// Archive with the shaders of many input files, targets and stages, written by ShaderPackWriter (bgfx-slang-cmd --pack).
+// Little endian layout:
+// - ShaderPackHeader
+// - ShaderPackEntry index sorted by the entry keys
+// - string table, nul terminated strings referenced by the entries
+// - zstd dictionary shared by the compressed blobs (optional)
+// - bgfx shader blobs aligned to 16 bytes, identical blobs are stored once
+// The reader doesn't depend on slang and doesn't copy anything, so the file can be memory mapped and the uncompressed blobs passed
+// to bgfx::makeRef directly. Compressed blobs are decompressed by Read when BGFXSLANG_ZSTD is defined (and zstd linked).
+constexpr uint32_t shaderPackMagic = 'B' | ('S' << 8) | ('P' << 16) | ('K' << 24);
+constexpr uint32_t shaderPackVersion = 2;
+constexpr uint32_t shaderPackBlobAlignment = 16;
+
+enum class ShaderPackCompression : uint32_t {
+  None,
+  Zstd,
+};
+
+struct ShaderPackHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t EntryCount;
+  uint32_t StringsOffset;
+  uint32_t StringsSize;
+  uint32_t DictionaryOffset;
+  uint32_t DictionarySize;
+  uint32_t BlobsOffset;
+  uint32_t BlobsSize;
+  uint32_t Reserved[3];
+};
+
+// offset in the string table and size without the nul terminator
+struct ShaderPackString {
+  uint32_t Offset;
+  uint32_t Size;
+};
+
+struct ShaderPackEntry {
+  ShaderPackString Name;
+  ShaderPackString EntryPoint;
+  ShaderPackString Stage;
+  ShaderPackString Target;
+  ShaderPackString Tag;
+  uint32_t Permutation;
+  ShaderPackCompression Compression;
+  // offset from the start of the pack and size of the stored (possibly compressed) data
+  uint32_t DataOffset;
+  uint32_t DataSize;
+  uint32_t UncompressedSize;
+};
+
+static_assert(sizeof(ShaderPackHeader) == 48);
+static_assert(sizeof(ShaderPackEntry) == 60);
+
+// Name is the input file name without extension, Stage and Target are the short names used in the output path templates
+// (vs, fs, cs and dx11, spirv, glsl, essl). Tag is the first argument of the entry point user attribute selected when the pack
+// was written, empty when not used.
+struct ShaderPackKey {
+  std::string_view Name;
+  std::string_view EntryPoint;
+  std::string_view Stage;
+  std::string_view Target;
+  std::string_view Tag;
+  uint32_t Permutation = 0;
+
+  auto operator<=>(const ShaderPackKey &) const = default;
+};
+
+class ShaderPack {
+public:
+  ShaderPack() = default;
+  ~ShaderPack() { release(); }
+  ShaderPack(const ShaderPack &) = delete;
+  ShaderPack &operator=(const ShaderPack &) = delete;
+  ShaderPack(ShaderPack &&) = delete;
+  ShaderPack &operator=(ShaderPack &&) = delete;
+
+  // The data must stay valid while the pack is used. Returns false when the data is not a valid pack or its dictionary can't be loaded.
+  bool Open(std::span<const uint8_t> packData) {
+    release();
+
+    ShaderPackHeader header;
+    if (packData.size() < sizeof(header)) {
+      return false;
+    }
+    std::memcpy(&header, packData.data(), sizeof(header));
+    if (header.Magic != shaderPackMagic || header.Version != shaderPackVersion ||
+        static_cast<uint64_t>(header.EntryCount) * sizeof(ShaderPackEntry) > packData.size() - sizeof(header) ||
+        !isInRange(packData, header.StringsOffset, header.StringsSize) ||
+        !isInRange(packData, header.DictionaryOffset, header.DictionarySize) ||
+        !isInRange(packData, header.BlobsOffset, header.BlobsSize)) {
+      return false;
+    }
+
+    data = packData;
+    strings = packData.subspan(header.StringsOffset, header.StringsSize);
+    entryCount = header.EntryCount;
+
+    // validated once, so the lookups don't need to check the offsets
+    for (size_t i = 0; i < entryCount; i++) {
+      const auto entry = getEntry(i);
+      const bool isValidData = entry.Compression == ShaderPackCompression::None ? entry.DataSize == entry.UncompressedSize
+                                                                                : entry.Compression == ShaderPackCompression::Zstd;
+      if (!isValidData || !isInRange(data, entry.DataOffset, entry.DataSize) || !isValidString(entry.Name) ||
+          !isValidString(entry.EntryPoint) || !isValidString(entry.Stage) || !isValidString(entry.Target) || !isValidString(entry.Tag)) {
+        release();
+        return false;
+      }
+    }
+
+#ifdef BGFXSLANG_ZSTD
+    if (header.DictionarySize > 0) {
+      dictionary = ZSTD_createDDict(data.data() + header.DictionaryOffset, header.DictionarySize);
+      if (dictionary == nullptr) {
+        release();
+        return false;
+      }
+    }
+#endif
+    return true;
+  }
+
+  [[nodiscard]] size_t GetEntryCount() const { return entryCount; }
+
+  [[nodiscard]] ShaderPackKey GetKey(size_t idx) const {
+    const auto entry = getEntry(idx);
+    return {getString(entry.Name),  getString(entry.EntryPoint), getString(entry.Stage),
+            getString(entry.Target), getString(entry.Tag),        entry.Permutation};
+  }
+
+  [[nodiscard]] bool IsCompressed(size_t idx) const { return getEntry(idx).Compression != ShaderPackCompression::None; }
+
+  // Size of the shader after decompression.
+  [[nodiscard]] size_t GetSize(size_t idx) const { return getEntry(idx).UncompressedSize; }
+
+  // Stored data of the shader, compressed when IsCompressed.
+  [[nodiscard]] std::span<const uint8_t> GetData(size_t idx) const {
+    const auto entry = getEntry(idx);
+    return data.subspan(entry.DataOffset, entry.DataSize);
+  }
+
+  // Copies or decompresses the shader to out, which must be GetSize bytes long. Returns false when the shader can't be
+  // decompressed, compressed shaders need BGFXSLANG_ZSTD.
+  bool Read(size_t idx, std::span<uint8_t> out) const {
+    const auto entry = getEntry(idx);
+    if (out.size() != entry.UncompressedSize) {
+      return false;
+    }
+    const auto stored = data.subspan(entry.DataOffset, entry.DataSize);
+    if (entry.Compression == ShaderPackCompression::None) {
+      std::memcpy(out.data(), stored.data(), stored.size());
+      return true;
+    }
+
+#ifdef BGFXSLANG_ZSTD
+    // one context per thread, so a pack can be read from many threads
+    thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context{ZSTD_createDCtx(), ZSTD_freeDCtx};
+    const size_t size = dictionary != nullptr
+                            ? ZSTD_decompress_usingDDict(context.get(), out.data(), out.size(), stored.data(), stored.size(), dictionary)
+                            : ZSTD_decompressDCtx(context.get(), out.data(), out.size(), stored.data(), stored.size());
+    return ZSTD_isError(size) == 0 && size == out.size();
+#else
+    return false;
+#endif
+  }
+
+  // Binary search in the index. Returns -1 when the pack has no shader with the key.
+  [[nodiscard]] int64_t FindIndex(const ShaderPackKey &key) const {
+    size_t first = 0;
+    size_t count = entryCount;
+    while (count > 0) {
+      const size_t step = count / 2;
+      if (GetKey(first + step) < key) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+    return first < entryCount && GetKey(first) == key ? static_cast<int64_t>(first) : -1;
+  }
+
+  // Stored data of the shader with the key (see GetData), empty span when not found.
+  [[nodiscard]] std::span<const uint8_t> Find(const ShaderPackKey &key) const {
+    const auto idx = FindIndex(key);
+    return idx >= 0 ? GetData(idx) : std::span<const uint8_t>{};
+  }
+
+private:
+  std::span<const uint8_t> data;
+  std::span<const uint8_t> strings;
+  size_t entryCount = 0;
+#ifdef BGFXSLANG_ZSTD
+  ZSTD_DDict *dictionary = nullptr;
+#endif
+
+  void release() {
+    data = {};
+    strings = {};
+    entryCount = 0;
+#ifdef BGFXSLANG_ZSTD
+    ZSTD_freeDDict(dictionary);
+    dictionary = nullptr;
+#endif
+  }
+
+  static bool isInRange(std::span<const uint8_t> range, uint32_t offset, uint32_t size) {
+    return offset <= range.size() && size <= range.size() - offset;
+  }
+
+  [[nodiscard]] bool isValidString(const ShaderPackString &str) const {
+    return str.Size < UINT32_MAX && isInRange(strings, str.Offset, str.Size + 1) && strings[str.Offset + str.Size] == '\0';
+  }
+
+  [[nodiscard]] ShaderPackEntry getEntry(size_t idx) const {
+    ShaderPackEntry entry;
+    std::memcpy(&entry, data.data() + sizeof(ShaderPackHeader) + idx * sizeof(ShaderPackEntry), sizeof(entry));
+    return entry;
+  }
+
+  [[nodiscard]] std::string_view getString(const ShaderPackString &str) const {
+    return {reinterpret_cast<const char *>(strings.data()) + str.Offset, str.Size};
+  }
+};
+
+} // namespace BgfxSlang
@@ -0,0 +1,232 @@
+#include "ShaderPackWriter.h"
+#include "ShaderPack.h"
+#include "Status.h"
+#include "Utils/Hash.h"
+#include "Utils/IWriter.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifdef BGFXSLANG_ZSTD
+#include <memory>
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+namespace BgfxSlang {
+
+namespace {
+constexpr size_t alignBlob(size_t offset) { return (offset + shaderPackBlobAlignment - 1) & ~size_t{shaderPackBlobAlignment - 1}; }
+
+#ifdef BGFXSLANG_ZSTD
+// zstd dictionary training needs a number of samples, with fewer blobs the dictionary would not pay for itself
+constexpr size_t minDictionarySamples = 16;
+constexpr size_t maxDictionarySize = 112 * 1024;
+// dictionary about tenth of the samples size, as recommended by zstd
+constexpr size_t dictionarySizeRatio = 10;
+
+std::vector<uint8_t> trainDictionary(const std::vector<std::vector<uint8_t>> &blobs) {
+  if (blobs.size() < minDictionarySamples) {
+    return {};
+  }
+
+  std::vector<uint8_t> samples;
+  std::vector<size_t> sampleSizes;
+  sampleSizes.reserve(blobs.size());
+  for (const auto &blob : blobs) {
+    samples.insert(samples.end(), blob.begin(), blob.end());
+    sampleSizes.push_back(blob.size());
+  }
+
+  std::vector<uint8_t> dictionary(std::min(maxDictionarySize, samples.size() / dictionarySizeRatio));
+  const auto size = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samples.data(), sampleSizes.data(),
+                                          static_cast<unsigned>(sampleSizes.size()));
+  if (ZDICT_isError(size) != 0) {
+    return {};
+  }
+  dictionary.resize(size);
+  return dictionary;
+}
+#endif
+
+// nul terminated strings, every distinct string is stored once
+class StringTable {
+public:
+  ShaderPackString Add(std::string_view str) {
+    auto [it, inserted] = offsets.try_emplace(std::string(str), static_cast<uint32_t>(data.size()));
+    if (inserted) {
+      data.insert(data.end(), str.begin(), str.end());
+      data.push_back('\0');
+    }
+    return {it->second, static_cast<uint32_t>(str.size())};
+  }
+
+  [[nodiscard]] const std::vector<char> &GetData() const { return data; }
+
+private:
+  std::vector<char> data;
+  std::unordered_map<std::string, uint32_t> offsets;
+};
+} // namespace
+
+Status ShaderPackWriter::SetCompression(ShaderPackCompression packCompression, int level) {
+#ifndef BGFXSLANG_ZSTD
+  if (packCompression == ShaderPackCompression::Zstd) {
+    return Status{StatusCode::Error, "Shader pack compression requires library built with BGFXSLANG_ZSTD"};
+  }
+#else
+  if (packCompression == ShaderPackCompression::Zstd && (level < ZSTD_minCLevel() || level > ZSTD_maxCLevel())) {
+    return Status{StatusCode::Error, "Shader pack compression level must be from " + std::to_string(ZSTD_minCLevel()) + " to " +
+                                         std::to_string(ZSTD_maxCLevel()) + ": " + std::to_string(level)};
+  }
+#endif
+  compression = packCompression;
+  compressionLevel = level;
+  return Status{};
+}
+
+void ShaderPackWriter::Add(const ShaderPackKey &key, std::span<const uint8_t> data) {
+  const auto hash = fnv1a64(std::string_view{reinterpret_cast<const char *>(data.data()), data.size()});
+
+  size_t blobIdx = blobs.size();
+  auto [first, last] = blobsByHash.equal_range(hash);
+  for (auto it = first; it != last; ++it) {
+    if (std::ranges::equal(blobs[it->second], data)) {
+      blobIdx = it->second;
+      break;
+    }
+  }
+  if (blobIdx == blobs.size()) {
+    blobs.emplace_back(data.begin(), data.end());
+    blobsByHash.emplace(hash, blobIdx);
+  }
+
+  entries.push_back({std::string(key.Name), std::string(key.EntryPoint), std::string(key.Stage), std::string(key.Target),
+                     std::string(key.Tag), key.Permutation, blobIdx});
+}
+
+Status ShaderPackWriter::packBlobs(std::vector<uint8_t> &dictionary, std::vector<PackedBlob> &packedBlobs) const {
+  packedBlobs.resize(blobs.size());
+  if (compression == ShaderPackCompression::None) {
+    for (size_t i = 0; i < blobs.size(); i++) {
+      packedBlobs[i].Data = blobs[i];
+    }
+    return Status{};
+  }
+
+#ifdef BGFXSLANG_ZSTD
+  dictionary = trainDictionary(blobs);
+
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context{ZSTD_createCCtx(), ZSTD_freeCCtx};
+  std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> compressionDictionary{nullptr, ZSTD_freeCDict};
+  if (!dictionary.empty()) {
+    compressionDictionary.reset(ZSTD_createCDict(dictionary.data(), dictionary.size(), compressionLevel));
+  }
+  if (context == nullptr || (!dictionary.empty() && compressionDictionary == nullptr)) {
+    return Status{StatusCode::Error, "Failed to create zstd compression context"};
+  }
+
+  for (size_t i = 0; i < blobs.size(); i++) {
+    const auto &blob = blobs[i];
+    auto &packed = packedBlobs[i];
+    packed.Data.resize(ZSTD_compressBound(blob.size()));
+    const auto size = compressionDictionary != nullptr
+                          ? ZSTD_compress_usingCDict(context.get(), packed.Data.data(), packed.Data.size(), blob.data(), blob.size(),
+                                                     compressionDictionary.get())
+                          : ZSTD_compressCCtx(context.get(), packed.Data.data(), packed.Data.size(), blob.data(), blob.size(),
+                                              compressionLevel);
+    if (ZSTD_isError(size) != 0) {
+      return Status{StatusCode::Error, "Failed to compress shader pack blob"};
+    }
+
+    if (size < blob.size()) {
+      packed.Compression = ShaderPackCompression::Zstd;
+      packed.Data.resize(size);
+    } else {
+      packed.Data = blob;
+    }
+  }
+  return Status{};
+#else
+  return Status{StatusCode::Error, "Shader pack compression requires library built with BGFXSLANG_ZSTD"};
+#endif
+}
+
+Status ShaderPackWriter::Write(IWriter &writer) const {
+  std::vector<size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].GetKey() < entries[b].GetKey(); });
+
+  for (size_t i = 1; i < order.size(); i++) {
+    if (entries[order[i - 1]].GetKey() == entries[order[i]].GetKey()) {
+      const auto &entry = entries[order[i]];
+      return Status{StatusCode::Error, "Shader pack has multiple shaders for: " + entry.Name + " " + entry.EntryPoint + " (" +
+                                           entry.Stage + ", " + entry.Target + ")"};
+    }
+  }
+
+  std::vector<uint8_t> dictionary;
+  std::vector<PackedBlob> packedBlobs;
+  if (auto status = packBlobs(dictionary, packedBlobs); status.IsError()) {
+    return status;
+  }
+
+  StringTable strings;
+  std::vector<ShaderPackEntry> packEntries;
+  packEntries.reserve(entries.size());
+  for (const auto idx : order) {
+    const auto &entry = entries[idx];
+    const auto &blob = packedBlobs[entry.BlobIdx];
+    packEntries.push_back({strings.Add(entry.Name), strings.Add(entry.EntryPoint), strings.Add(entry.Stage), strings.Add(entry.Target),
+                           strings.Add(entry.Tag), entry.Permutation, blob.Compression, 0, static_cast<uint32_t>(blob.Data.size()),
+                           static_cast<uint32_t>(blobs[entry.BlobIdx].size())});
+  }
+
+  ShaderPackHeader header = {};
+  header.Magic = shaderPackMagic;
+  header.Version = shaderPackVersion;
+  header.EntryCount = static_cast<uint32_t>(packEntries.size());
+  header.StringsOffset = static_cast<uint32_t>(sizeof(ShaderPackHeader) + packEntries.size() * sizeof(ShaderPackEntry));
+  header.StringsSize = static_cast<uint32_t>(strings.GetData().size());
+  header.DictionaryOffset = header.StringsOffset + header.StringsSize;
+  header.DictionarySize = static_cast<uint32_t>(dictionary.size());
+  header.BlobsOffset = static_cast<uint32_t>(alignBlob(header.DictionaryOffset + header.DictionarySize));
+
+  std::vector<size_t> blobOffsets(packedBlobs.size());
+  size_t blobsEnd = header.BlobsOffset;
+  for (size_t i = 0; i < packedBlobs.size(); i++) {
+    blobOffsets[i] = alignBlob(blobsEnd);
+    blobsEnd = blobOffsets[i] + packedBlobs[i].Data.size();
+  }
+  if (blobsEnd > UINT32_MAX) {
+    return Status{StatusCode::Error, "Shader pack is larger than 4GB"};
+  }
+  header.BlobsSize = static_cast<uint32_t>(blobsEnd - header.BlobsOffset);
+
+  for (size_t i = 0; i < order.size(); i++) {
+    packEntries[i].DataOffset = static_cast<uint32_t>(blobOffsets[entries[order[i]].BlobIdx]);
+  }
+
+  static constexpr uint8_t padding[shaderPackBlobAlignment] = {};
+  writer.Reserve(blobsEnd);
+  writer.Write(header);
+  writer.Write(packEntries.data(), packEntries.size() * sizeof(ShaderPackEntry));
+  writer.Write(strings.GetData().data(), strings.GetData().size());
+  writer.Write(dictionary.data(), dictionary.size());
+
+  size_t offset = header.DictionaryOffset + header.DictionarySize;
+  for (size_t i = 0; i < packedBlobs.size(); i++) {
+    writer.Write(padding, blobOffsets[i] - offset);
+    writer.Write(packedBlobs[i].Data.data(), packedBlobs[i].Data.size());
+    offset = blobOffsets[i] + packedBlobs[i].Data.size();
+  }
+  return Status{};
+}
+
+} // namespace BgfxSlang
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ShaderPack.h"
+#include "Status.h"
+#include "Utils/IWriter.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace BgfxSlang {
+
+// Builds a ShaderPack. Identical blobs are stored once, the index is sorted by the keys when the pack is written.
+class ShaderPackWriter {
+public:
+  static constexpr int defaultCompressionLevel = 19;
+
+  // The unique blobs are compressed separately, with a dictionary trained on all of them when there are enough blobs for it.
+  // Blobs that don't get smaller are stored uncompressed. Fails when the library is built without BGFXSLANG_ZSTD or the level is
+  // outside ZSTD_minCLevel() to ZSTD_maxCLevel().
+  Status SetCompression(ShaderPackCompression packCompression, int level = defaultCompressionLevel);
+
+  // The key strings and the data are copied.
+  void Add(const ShaderPackKey &key, std::span<const uint8_t> data);
+
+  // Fails when the same key was added more than once.
+  Status Write(IWriter &writer) const;
+
+  [[nodiscard]] size_t GetEntryCount() const { return entries.size(); }
+  [[nodiscard]] size_t GetBlobCount() const { return blobs.size(); }
+
+private:
+  struct Entry {
+    std::string Name;
+    std::string EntryPoint;
+    std::string Stage;
+    std::string Target;
+    std::string Tag;
+    uint32_t Permutation;
+    size_t BlobIdx;
+
+    [[nodiscard]] ShaderPackKey GetKey() const { return {Name, EntryPoint, Stage, Target, Tag, Permutation}; }
+  };
+
+  // stored form of the unique blob
+  struct PackedBlob {
+    ShaderPackCompression Compression = ShaderPackCompression::None;
+    std::vector<uint8_t> Data;
+  };
+
+  ShaderPackCompression compression = ShaderPackCompression::None;
+  int compressionLevel = defaultCompressionLevel;
+  std::vector<Entry> entries;
+  std::vector<std::vector<uint8_t>> blobs;
+  std::unordered_multimap<uint64_t, size_t> blobsByHash;
+
+  Status packBlobs(std::vector<uint8_t> &dictionary, std::vector<PackedBlob> &packedBlobs) const;
+};
+
+} // namespace BgfxSlang
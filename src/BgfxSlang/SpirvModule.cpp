@@ -0,0 +1,74 @@
+#include "SpirvModule.h"
+#include "spirv.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlang {
+
+std::string_view SpirvInstruction::GetString(size_t idx, size_t *outWordCount) const {
+  const auto operands = GetOperands(idx);
+  const auto *chars = reinterpret_cast<const char *>(operands.data());
+  const auto maxLength = operands.size() * sizeof(uint32_t);
+  const auto length = strnlen(chars, maxLength);
+
+  if (outWordCount != nullptr) {
+    *outWordCount = length / sizeof(uint32_t) + 1;
+  }
+  return {chars, length};
+}
+
+bool SpirvModule::Parse(std::span<const uint32_t> words) {
+  instructions.clear();
+  if (words.size() < HeaderSize || words[0] != spv::MagicNumber) {
+    return false;
+  }
+
+  header = words.first(HeaderSize);
+  bound = header[3];
+
+  size_t offset = HeaderSize;
+  while (offset < words.size()) {
+    const auto wordCount = words[offset] >> spv::WordCountShift;
+    if (wordCount == 0 || offset + wordCount > words.size()) {
+      return false;
+    }
+    instructions.push_back({static_cast<spv::Op>(words[offset] & spv::OpCodeMask), words.subspan(offset, wordCount)});
+    offset += wordCount;
+  }
+  return true;
+}
+
+void SpirvModule::EmitHeader(std::vector<uint32_t> &out) const {
+  out.insert(out.end(), header.begin(), header.end());
+  out[out.size() - HeaderSize + 3] = bound;
+}
+
+void SpirvModule::Emit(std::vector<uint32_t> &out, spv::Op opcode, std::initializer_list<uint32_t> operands) {
+  Emit(out, opcode, std::span<const uint32_t>(operands.begin(), operands.size()));
+}
+
+void SpirvModule::Emit(std::vector<uint32_t> &out, spv::Op opcode, std::span<const uint32_t> operands) {
+  out.push_back(static_cast<uint32_t>(operands.size() + 1) << spv::WordCountShift | opcode);
+  out.insert(out.end(), operands.begin(), operands.end());
+}
+
+void SpirvModule::Emit(std::vector<uint32_t> &out, const SpirvInstruction &instruction) {
+  out.insert(out.end(), instruction.Words.begin(), instruction.Words.end());
+}
+
+void SpirvModule::EmitName(std::vector<uint32_t> &out, uint32_t id, std::string_view name) {
+  const auto nameWords = name.size() / sizeof(uint32_t) + 1;
+  out.push_back(static_cast<uint32_t>(nameWords + 2) << spv::WordCountShift | spv::OpName);
+  out.push_back(id);
+
+  const auto start = out.size();
+  out.resize(start + nameWords, 0);
+  std::memcpy(out.data() + start, name.data(), name.size());
+}
+
+} // namespace BgfxSlang
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "spirv.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlang {
+
+struct SpirvInstruction {
+  spv::Op Opcode;
+  // all the words of the instruction, including the opcode word
+  std::span<const uint32_t> Words;
+
+  [[nodiscard]] inline size_t GetOperandCount() const { return Words.size() - 1; }
+  [[nodiscard]] inline uint32_t GetOperand(size_t idx) const { return Words[idx + 1]; }
+  [[nodiscard]] inline std::span<const uint32_t> GetOperands(size_t first = 0) const { return Words.subspan(first + 1); }
+  // Nul terminated string literal starting at operand idx, returns number of operands it takes through outWordCount.
+  [[nodiscard]] std::string_view GetString(size_t idx, size_t *outWordCount = nullptr) const;
+};
+
+// Minimal SPIR-V module view for the passes run before SPIRV-Cross. Instructions point to the original words, passes write new
+// module with SpirvModule::Emit functions.
+class SpirvModule {
+public:
+  static constexpr size_t HeaderSize = 5;
+
+  // Returns false for malformed module.
+  bool Parse(std::span<const uint32_t> words);
+
+  [[nodiscard]] inline uint32_t GetVersion() const { return header[1]; }
+  [[nodiscard]] inline uint32_t GetBound() const { return bound; }
+  [[nodiscard]] inline const std::vector<SpirvInstruction> &GetInstructions() const { return instructions; }
+
+  uint32_t AllocateId() { return bound++; }
+
+  // Module header with the current id bound.
+  void EmitHeader(std::vector<uint32_t> &out) const;
+
+  static void Emit(std::vector<uint32_t> &out, spv::Op opcode, std::initializer_list<uint32_t> operands);
+  static void Emit(std::vector<uint32_t> &out, spv::Op opcode, std::span<const uint32_t> operands);
+  static void Emit(std::vector<uint32_t> &out, const SpirvInstruction &instruction);
+  static void EmitName(std::vector<uint32_t> &out, uint32_t id, std::string_view name);
+
+private:
+  std::span<const uint32_t> header;
+  std::vector<SpirvInstruction> instructions;
+  uint32_t bound = 0;
+};
+
+} // namespace BgfxSlang
@@ -0,0 +1,909 @@
+#include "SpirvPasses.h"
+#include "SpirvModule.h"
+#include "UniformPacking.h"
+#include "spirv.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace BgfxSlang {
+
+namespace {
+// GLSL.std.450 instructions storing to their pointer operand
+constexpr uint32_t glslModf = 35;
+constexpr uint32_t glslFrexp = 51;
+
+struct FlattenedMember {
+  uint32_t VariableId;
+  uint32_t PointerId;
+  std::string_view Name;
+  // std140 wrapper struct, its only member is used as the uniform
+  bool IsWrapper;
+  // read from the packed uniform array, VariableId is the array
+  const PackedUniformField *Packed;
+};
+
+struct PackedAccess {
+  uint32_t Register;
+  uint32_t Component;
+  uint32_t ComponentCount;
+};
+
+// Type found in the module, new types and constants are added in place of the buffers, so they can use only the earlier ones.
+struct TypeDeclaration {
+  uint32_t Id = 0;
+  size_t InstructionIdx = 0;
+
+  void Find(uint32_t id, size_t instructionIdx) {
+    if (Id == 0) {
+      Id = id;
+      InstructionIdx = instructionIdx;
+    }
+  }
+  [[nodiscard]] bool IsDeclaredBefore(size_t instructionIdx) const { return Id != 0 && InstructionIdx < instructionIdx; }
+};
+
+struct FlattenedBuffer {
+  std::vector<FlattenedMember> Members;
+};
+
+bool isPreambleOrDebug(spv::Op opcode) {
+  switch (opcode) {
+  case spv::OpCapability:
+  case spv::OpExtension:
+  case spv::OpExtInstImport:
+  case spv::OpMemoryModel:
+  case spv::OpEntryPoint:
+  case spv::OpExecutionMode:
+  case spv::OpExecutionModeId:
+  case spv::OpSourceContinued:
+  case spv::OpSource:
+  case spv::OpSourceExtension:
+  case spv::OpName:
+  case spv::OpMemberName:
+  case spv::OpString:
+  case spv::OpModuleProcessed:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Instructions which can't reference uniform buffer pointers, their literal operands could be mistaken for ids.
+bool isPointerFree(spv::Op opcode) {
+  if (opcode >= spv::OpTypeVoid && opcode <= spv::OpTypeFunction) {
+    return true;
+  }
+
+  switch (opcode) {
+  case spv::OpSourceContinued:
+  case spv::OpSource:
+  case spv::OpSourceExtension:
+  case spv::OpMemberName:
+  case spv::OpString:
+  case spv::OpLine:
+  case spv::OpModuleProcessed:
+  case spv::OpMemberDecorate:
+  case spv::OpMemberDecorateString:
+  case spv::OpCapability:
+  case spv::OpExtension:
+  case spv::OpExtInstImport:
+  case spv::OpMemoryModel:
+  case spv::OpExecutionMode:
+  case spv::OpConstant:
+  case spv::OpSpecConstant:
+  case spv::OpVectorShuffle:
+  case spv::OpCompositeExtract:
+  case spv::OpCompositeInsert:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Instructions without side effects, removed when nothing uses their result.
+bool isRemovableComputation(spv::Op opcode) {
+  const auto inRange = [opcode](spv::Op first, spv::Op last) { return opcode >= first && opcode <= last; };
+  return opcode == spv::OpLoad || opcode == spv::OpPhi || inRange(spv::OpAccessChain, spv::OpPtrAccessChain) ||
+         inRange(spv::OpVectorExtractDynamic, spv::OpTranspose) || inRange(spv::OpSampledImage, spv::OpImageDrefGather) ||
+         inRange(spv::OpImage, spv::OpImageQuerySamples) || inRange(spv::OpConvertFToU, spv::OpSMulExtended) ||
+         inRange(spv::OpAny, spv::OpBitCount) || inRange(spv::OpDPdx, spv::OpFwidthCoarse);
+}
+
+// GLSL.std.450 instructions without side effects, Modf and Frexp store the whole part and the exponent through a pointer.
+bool isRemovableGlslExtInst(const SpirvInstruction &inst, uint32_t glslExtInstSet) {
+  return glslExtInstSet != 0 && inst.GetOperandCount() >= 4 && inst.GetOperand(2) == glslExtInstSet && inst.GetOperand(3) != glslModf &&
+         inst.GetOperand(3) != glslFrexp;
+}
+
+bool isNameOrDecoration(spv::Op opcode) {
+  switch (opcode) {
+  case spv::OpName:
+  case spv::OpDecorate:
+  case spv::OpDecorateId:
+  case spv::OpDecorateString:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool isConstant(spv::Op opcode) { return opcode == spv::OpUndef || (opcode >= spv::OpConstantTrue && opcode <= spv::OpConstantNull); }
+
+// Removes the computations without uses, and the ones only they used, until no more results become unused. The instructions already
+// dropped from keep are not uses. Literal operands counted as uses only keep some instructions alive. withConstants - the global
+// constants without uses are removed as well.
+void removeUnusedResults(const std::vector<SpirvInstruction> &instructions, uint32_t glslExtInstSet, bool withConstants,
+                         std::vector<bool> &keep, std::unordered_set<uint32_t> &removed) {
+  std::vector<bool> isRemovable(instructions.size(), false);
+  std::unordered_map<uint32_t, size_t> definitions;
+  std::unordered_map<uint32_t, uint32_t> useCounts;
+  bool inFunction = false;
+  for (size_t i = 0; i < instructions.size(); i++) {
+    const auto &inst = instructions[i];
+    inFunction = (inFunction || inst.Opcode == spv::OpFunction) && inst.Opcode != spv::OpFunctionEnd;
+    if (!keep[i] || (isNameOrDecoration(inst.Opcode) && inst.Opcode != spv::OpDecorateId)) {
+      continue;
+    }
+    // the decorated id is not a use
+    if (inst.Opcode == spv::OpDecorateId) {
+      for (auto operand : inst.GetOperands(2)) {
+        useCounts[operand]++;
+      }
+      continue;
+    }
+
+    isRemovable[i] = inst.GetOperandCount() >= 2 &&
+                     ((inFunction && (isRemovableComputation(inst.Opcode) ||
+                                      (inst.Opcode == spv::OpExtInst && isRemovableGlslExtInst(inst, glslExtInstSet)))) ||
+                      (withConstants && !inFunction && isConstant(inst.Opcode)));
+    if (isRemovable[i]) {
+      definitions[inst.GetOperand(1)] = i;
+    }
+    for (auto operand : inst.GetOperands(isRemovable[i] ? 2 : 0)) {
+      useCounts[operand]++;
+    }
+  }
+
+  std::vector<size_t> unused;
+  for (const auto &[id, idx] : definitions) {
+    if (!useCounts.contains(id)) {
+      unused.push_back(idx);
+    }
+  }
+  while (!unused.empty()) {
+    const auto &inst = instructions[unused.back()];
+    keep[unused.back()] = false;
+    unused.pop_back();
+    removed.insert(inst.GetOperand(1));
+
+    for (auto operand : inst.GetOperands(2)) {
+      auto definitionIt = definitions.find(operand);
+      if (--useCounts[operand] == 0 && definitionIt != definitions.end() && keep[definitionIt->second]) {
+        unused.push_back(definitionIt->second);
+      }
+    }
+  }
+}
+
+bool isDebugLocation(spv::Op opcode) {
+  switch (opcode) {
+  case spv::OpSourceContinued:
+  case spv::OpSource:
+  case spv::OpSourceExtension:
+  case spv::OpString:
+  case spv::OpLine:
+  case spv::OpNoLine:
+  case spv::OpModuleProcessed:
+    return true;
+  default:
+    return false;
+  }
+}
+
+using MemberNames = std::map<std::pair<uint32_t, uint32_t>, std::string_view>;
+
+void getBlockMembers(const SpirvModule &module, std::unordered_set<uint32_t> &outBlockStructs, MemberNames &outMemberNames) {
+  for (const auto &inst : module.GetInstructions()) {
+    if (inst.Opcode == spv::OpMemberName) {
+      outMemberNames[{inst.GetOperand(0), inst.GetOperand(1)}] = inst.GetString(2);
+    } else if (inst.Opcode == spv::OpDecorate && inst.GetOperand(1) == spv::DecorationBlock) {
+      outBlockStructs.insert(inst.GetOperand(0));
+    }
+  }
+}
+
+// The global uniforms are the block with the most of the global names, 0 when no block has any.
+template <typename IsGlobalName>
+uint32_t findGlobalsStruct(const std::unordered_set<uint32_t> &blockStructs, const MemberNames &memberNames, IsGlobalName isGlobalName) {
+  uint32_t globalsStruct = 0;
+  size_t globalsMatches = 0;
+  for (const auto structId : blockStructs) {
+    size_t matches = 0;
+    for (auto it = memberNames.lower_bound({structId, 0}); it != memberNames.end() && it->first.first == structId; ++it) {
+      matches += isGlobalName(it->second) ? 1 : 0;
+    }
+    if (matches > globalsMatches || (matches == globalsMatches && matches > 0 && structId < globalsStruct)) {
+      globalsStruct = structId;
+      globalsMatches = matches;
+    }
+  }
+  return globalsStruct;
+}
+
+} // namespace
+
+bool flattenUniformBuffers(std::vector<uint32_t> &spirv, const UniformPacking *packing) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return false;
+  }
+
+  std::unordered_set<uint32_t> blockStructs;
+  // structs with row major matrix members, plain uniform matrices are column major
+  std::unordered_set<uint32_t> rowMajorStructs;
+  std::unordered_set<uint32_t> intTypes;
+  std::unordered_map<uint32_t, uint32_t> intConstants;
+  std::unordered_map<uint32_t, std::span<const uint32_t>> structMembers;
+  std::unordered_map<uint32_t, uint32_t> pointerTypes;
+  std::unordered_map<uint32_t, uint32_t> uniformConstantPointers;
+  // instruction index of the UniformConstant pointer types by their id
+  std::unordered_map<uint32_t, size_t> pointerDeclarations;
+  std::map<std::pair<uint32_t, uint32_t>, std::string_view> memberNames;
+  std::vector<std::pair<uint32_t, uint32_t>> bufferVariables;
+  // types the packed uniform array is built from, with their instruction index, they must be declared before the buffers
+  TypeDeclaration floatType;
+  TypeDeclaration intType;
+  TypeDeclaration uintType;
+  TypeDeclaration vec4Type;
+  size_t lastBufferVariableIdx = 0;
+
+  const auto &instructions = module.GetInstructions();
+  for (size_t i = 0; i < instructions.size(); i++) {
+    const auto &inst = instructions[i];
+    switch (inst.Opcode) {
+    case spv::OpMemberName:
+      memberNames[{inst.GetOperand(0), inst.GetOperand(1)}] = inst.GetString(2);
+      break;
+    case spv::OpDecorate:
+      if (inst.GetOperand(1) == spv::DecorationBlock) {
+        blockStructs.insert(inst.GetOperand(0));
+      }
+      break;
+    case spv::OpMemberDecorate:
+      if (inst.GetOperand(2) == spv::DecorationRowMajor) {
+        rowMajorStructs.insert(inst.GetOperand(0));
+      }
+      break;
+    case spv::OpTypeInt:
+      if (inst.GetOperand(1) == 32) {
+        intTypes.insert(inst.GetOperand(0));
+        intType.Find(inst.GetOperand(0), i);
+        if (inst.GetOperand(2) == 0) {
+          uintType.Find(inst.GetOperand(0), i);
+        }
+      }
+      break;
+    case spv::OpTypeFloat:
+      if (inst.GetOperand(1) == 32) {
+        floatType.Find(inst.GetOperand(0), i);
+      }
+      break;
+    case spv::OpTypeVector:
+      if (floatType.Id != 0 && inst.GetOperand(1) == floatType.Id && inst.GetOperand(2) == uniformRegisterComponents) {
+        vec4Type.Find(inst.GetOperand(0), i);
+      }
+      break;
+    case spv::OpConstant:
+      if (intTypes.contains(inst.GetOperand(0))) {
+        intConstants[inst.GetOperand(1)] = inst.GetOperand(2);
+      }
+      break;
+    case spv::OpTypeStruct:
+      structMembers[inst.GetOperand(0)] = inst.GetOperands(1);
+      break;
+    case spv::OpTypePointer:
+      pointerTypes[inst.GetOperand(0)] = inst.GetOperand(2);
+      if (inst.GetOperand(1) == spv::StorageClassUniformConstant) {
+        uniformConstantPointers.try_emplace(inst.GetOperand(2), inst.GetOperand(0));
+        pointerDeclarations[inst.GetOperand(0)] = i;
+      }
+      break;
+    case spv::OpVariable:
+      if (inst.GetOperand(2) == spv::StorageClassUniform) {
+        const auto pointee = pointerTypes[inst.GetOperand(0)];
+        if (blockStructs.contains(pointee)) {
+          bufferVariables.emplace_back(inst.GetOperand(1), pointee);
+          lastBufferVariableIdx = i;
+        }
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (bufferVariables.empty()) {
+    return true;
+  }
+
+  // the new globals take the place of the buffers, a type declared after them can't be used by them nor declared again, as the
+  // non-aggregate types must be unique
+  bool hasLateType = false;
+
+  std::vector<std::pair<uint32_t, uint32_t>> newPointers;
+  auto getUniformConstantPointer = [&](uint32_t pointee) {
+    auto [it, inserted] = uniformConstantPointers.try_emplace(pointee, 0);
+    if (inserted) {
+      it->second = module.AllocateId();
+      newPointers.emplace_back(it->second, pointee);
+    } else if (auto declarationIt = pointerDeclarations.find(it->second); declarationIt != pointerDeclarations.end()) {
+      hasLateType |= declarationIt->second > lastBufferVariableIdx;
+    }
+    return it->second;
+  };
+
+  // types and constants of the packed uniform array, the constants are added while the functions are rewritten
+  std::vector<uint32_t> packedGlobals;
+  std::unordered_map<uint32_t, uint32_t> packedConstants;
+  auto getIntConstant = [&](uint32_t value) {
+    if (!intType.IsDeclaredBefore(lastBufferVariableIdx)) {
+      hasLateType |= uintType.Id != 0;
+      intType = {module.AllocateId(), 0};
+      SpirvModule::Emit(packedGlobals, spv::OpTypeInt, {intType.Id, 32, 0});
+    }
+    auto [it, inserted] = packedConstants.try_emplace(value, 0);
+    if (inserted) {
+      it->second = module.AllocateId();
+      SpirvModule::Emit(packedGlobals, spv::OpConstant, {intType.Id, it->second, value});
+    }
+    return it->second;
+  };
+
+  uint32_t packedVariableId = 0;
+  uint32_t packedPointerId = 0;
+  auto getPackedVariable = [&]() {
+    if (packedVariableId == 0) {
+      if (!vec4Type.IsDeclaredBefore(lastBufferVariableIdx)) {
+        hasLateType |= vec4Type.Id != 0;
+        vec4Type = {module.AllocateId(), 0};
+        SpirvModule::Emit(packedGlobals, spv::OpTypeVector, {vec4Type.Id, floatType.Id, uniformRegisterComponents});
+      }
+      const auto arrayType = module.AllocateId();
+      SpirvModule::Emit(packedGlobals, spv::OpTypeArray, {arrayType, vec4Type.Id, getIntConstant(packing->RegisterCount)});
+      packedPointerId = getUniformConstantPointer(arrayType);
+      packedVariableId = module.AllocateId();
+    }
+    return packedVariableId;
+  };
+
+  std::unordered_map<uint32_t, FlattenedBuffer> buffers;
+  for (const auto &[variableId, structId] : bufferVariables) {
+    auto &buffer = buffers[variableId];
+    const auto members = structMembers[structId];
+    // the layout decorations stay on the struct, SPIRV-Cross would read the matrices transposed
+    if (rowMajorStructs.contains(structId)) {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < members.size(); i++) {
+      auto nameIt = memberNames.find({structId, i});
+      if (nameIt == memberNames.end()) {
+        return false;
+      }
+
+      auto memberType = members[i];
+      auto wrapperIt = structMembers.find(memberType);
+      const bool isWrapper = wrapperIt != structMembers.end();
+      if (isWrapper) {
+        if (wrapperIt->second.size() != 1 || rowMajorStructs.contains(wrapperIt->first)) {
+          return false;
+        }
+        memberType = wrapperIt->second[0];
+      }
+
+      const auto *packedField = packing != nullptr ? packing->Find(nameIt->second) : nullptr;
+      if (packedField != nullptr) {
+        if (isWrapper || !floatType.IsDeclaredBefore(lastBufferVariableIdx)) {
+          return false;
+        }
+        buffer.Members.push_back({getPackedVariable(), 0, nameIt->second, false, packedField});
+        continue;
+      }
+
+      buffer.Members.push_back({module.AllocateId(), getUniformConstantPointer(memberType), nameIt->second, isWrapper, nullptr});
+    }
+  }
+
+  // pointers derived from the uniform buffers, their storage class is changed to UniformConstant
+  std::unordered_set<uint32_t> convertedPointers;
+  // pointers to packed float2 and float3 uniforms, they are read from the whole register
+  std::unordered_map<uint32_t, PackedAccess> packedVectorPointers;
+  auto isBufferPointer = [&](uint32_t id) {
+    return buffers.contains(id) || convertedPointers.contains(id) || packedVectorPointers.contains(id);
+  };
+
+  std::vector<uint32_t> out;
+  out.reserve(spirv.size() + buffers.size() * 16);
+  module.EmitHeader(out);
+
+  size_t namesPos = out.size();
+  size_t globalsPos = out.size();
+  bool inPreamble = true;
+  std::vector<uint32_t> operands;
+
+  // packed float is pointed to directly, float2 and float3 components only through an index
+  auto emitPackedAccess = [&](const SpirvInstruction &inst, const PackedAccess &access, std::span<const uint32_t> indexes) {
+    const auto resultId = inst.GetOperand(1);
+    uint32_t componentId = 0;
+    if (indexes.empty()) {
+      if (access.ComponentCount > 1) {
+        packedVectorPointers[resultId] = access;
+        return true;
+      }
+      componentId = getIntConstant(access.Component);
+    } else {
+      auto indexIt = intConstants.find(indexes[0]);
+      if (indexes.size() != 1 || access.ComponentCount == 1 || (indexIt == intConstants.end() && access.Component != 0)) {
+        return false;
+      }
+      componentId = indexIt != intConstants.end() ? getIntConstant(access.Component + indexIt->second) : indexes[0];
+    }
+    SpirvModule::Emit(out, inst.Opcode,
+                      {getUniformConstantPointer(floatType.Id), resultId, packedVariableId, getIntConstant(access.Register), componentId});
+    return true;
+  };
+
+  for (const auto &inst : instructions) {
+    inPreamble = inPreamble && isPreambleOrDebug(inst.Opcode);
+
+    switch (inst.Opcode) {
+    case spv::OpName:
+      if (!buffers.contains(inst.GetOperand(0))) {
+        SpirvModule::Emit(out, inst);
+      }
+      break;
+    case spv::OpDecorate:
+    case spv::OpDecorateId:
+    case spv::OpDecorateString:
+      if (!buffers.contains(inst.GetOperand(0))) {
+        SpirvModule::Emit(out, inst);
+      }
+      break;
+    case spv::OpEntryPoint: {
+      size_t nameWords = 0;
+      (void)inst.GetString(2, &nameWords);
+      const auto interfaceStart = 2 + nameWords;
+
+      operands.assign(inst.Words.begin() + 1, inst.Words.begin() + 1 + interfaceStart);
+      bool hasPackedVariable = false;
+      for (auto id : inst.GetOperands(interfaceStart)) {
+        auto it = buffers.find(id);
+        if (it == buffers.end()) {
+          operands.push_back(id);
+          continue;
+        }
+        for (const auto &member : it->second.Members) {
+          if (member.Packed == nullptr || !hasPackedVariable) {
+            operands.push_back(member.VariableId);
+          }
+          hasPackedVariable |= member.Packed != nullptr;
+        }
+      }
+      SpirvModule::Emit(out, inst.Opcode, operands);
+      break;
+    }
+    case spv::OpVariable:
+      if (buffers.contains(inst.GetOperand(1))) {
+        globalsPos = out.size();
+      } else {
+        SpirvModule::Emit(out, inst);
+      }
+      break;
+    case spv::OpAccessChain:
+    case spv::OpInBoundsAccessChain: {
+      const auto base = inst.GetOperand(2);
+      if (auto packedIt = packedVectorPointers.find(base); packedIt != packedVectorPointers.end()) {
+        if (!emitPackedAccess(inst, packedIt->second, inst.GetOperands(3))) {
+          return false;
+        }
+        break;
+      }
+      if (!isBufferPointer(base)) {
+        SpirvModule::Emit(out, inst);
+        break;
+      }
+
+      auto pointeeIt = pointerTypes.find(inst.GetOperand(0));
+      if (pointeeIt == pointerTypes.end()) {
+        return false;
+      }
+
+      operands.assign({getUniformConstantPointer(pointeeIt->second), inst.GetOperand(1), base});
+      auto indexes = inst.GetOperands(3);
+
+      auto bufferIt = buffers.find(base);
+      if (bufferIt != buffers.end()) {
+        // first index selects the member, it becomes the base variable
+        auto memberIt = indexes.empty() ? intConstants.end() : intConstants.find(indexes[0]);
+        if (memberIt == intConstants.end() || memberIt->second >= bufferIt->second.Members.size()) {
+          return false;
+        }
+        const auto &member = bufferIt->second.Members[memberIt->second];
+        indexes = indexes.subspan(1);
+
+        if (member.Packed != nullptr) {
+          const PackedAccess access{member.Packed->Register, member.Packed->Component, member.Packed->ComponentCount};
+          if (!emitPackedAccess(inst, access, indexes)) {
+            return false;
+          }
+          break;
+        }
+
+        if (member.IsWrapper) {
+          auto dataIt = indexes.empty() ? intConstants.end() : intConstants.find(indexes[0]);
+          if (dataIt == intConstants.end() || dataIt->second != 0) {
+            return false;
+          }
+          indexes = indexes.subspan(1);
+        }
+        operands[2] = member.VariableId;
+      }
+
+      operands.insert(operands.end(), indexes.begin(), indexes.end());
+      SpirvModule::Emit(out, inst.Opcode, operands);
+      convertedPointers.insert(inst.GetOperand(1));
+      break;
+    }
+    case spv::OpLoad: {
+      // the packed vector is shuffled out of its register
+      if (auto packedIt = packedVectorPointers.find(inst.GetOperand(2)); packedIt != packedVectorPointers.end()) {
+        const auto &access = packedIt->second;
+        const auto registerPointerId = module.AllocateId();
+        const auto registerId = module.AllocateId();
+        SpirvModule::Emit(out, spv::OpAccessChain,
+                          {getUniformConstantPointer(vec4Type.Id), registerPointerId, packedVariableId, getIntConstant(access.Register)});
+        SpirvModule::Emit(out, spv::OpLoad, {vec4Type.Id, registerId, registerPointerId});
+        operands.assign({inst.GetOperand(0), inst.GetOperand(1), registerId, registerId});
+        for (uint32_t i = 0; i < access.ComponentCount; i++) {
+          operands.push_back(access.Component + i);
+        }
+        SpirvModule::Emit(out, spv::OpVectorShuffle, operands);
+        break;
+      }
+      // loads from converted pointers stay the same, memory operands after the pointer are literals
+      if (!buffers.contains(inst.GetOperand(2))) {
+        SpirvModule::Emit(out, inst);
+        break;
+      }
+      return false;
+    }
+    default:
+      if (!isPointerFree(inst.Opcode)) {
+        for (auto operand : inst.GetOperands()) {
+          if (isBufferPointer(operand)) {
+            return false;
+          }
+        }
+      }
+      SpirvModule::Emit(out, inst);
+      break;
+    }
+
+    if (inPreamble) {
+      namesPos = out.size();
+    }
+  }
+
+  if (hasLateType) {
+    return false;
+  }
+
+  std::vector<uint32_t> globals = std::move(packedGlobals);
+  for (const auto &[pointerId, pointee] : newPointers) {
+    SpirvModule::Emit(globals, spv::OpTypePointer, {pointerId, spv::StorageClassUniformConstant, pointee});
+  }
+  std::vector<uint32_t> names;
+  for (const auto &[variableId, structId] : bufferVariables) {
+    for (const auto &member : buffers[variableId].Members) {
+      if (member.Packed == nullptr) {
+        SpirvModule::Emit(globals, spv::OpVariable, {member.PointerId, member.VariableId, spv::StorageClassUniformConstant});
+        SpirvModule::EmitName(names, member.VariableId, member.Name);
+      }
+    }
+  }
+  if (packedVariableId != 0) {
+    SpirvModule::Emit(globals, spv::OpVariable, {packedPointerId, packedVariableId, spv::StorageClassUniformConstant});
+    SpirvModule::EmitName(names, packedVariableId, packing->Name);
+  }
+
+  // globals go in place of the last uniform buffer variable, after all the types used by the buffers
+  out.insert(out.begin() + static_cast<ptrdiff_t>(globalsPos), globals.begin(), globals.end());
+  out.insert(out.begin() + static_cast<ptrdiff_t>(namesPos), names.begin(), names.end());
+  out[3] = module.GetBound();
+
+  spirv = std::move(out);
+  return true;
+}
+
+bool setUniformBufferOffsets(std::vector<uint32_t> &spirv, std::span<const std::pair<std::string, uint32_t>> memberOffsets) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return false;
+  }
+
+  std::unordered_set<uint32_t> blockStructs;
+  MemberNames memberNames;
+  getBlockMembers(module, blockStructs, memberNames);
+
+  auto findOffset = [&](std::string_view name) -> const std::pair<std::string, uint32_t> * {
+    auto it = std::ranges::find(memberOffsets, name, &std::pair<std::string, uint32_t>::first);
+    return it != memberOffsets.end() ? &*it : nullptr;
+  };
+
+  const auto globalsStruct =
+      findGlobalsStruct(blockStructs, memberNames, [&](std::string_view name) { return findOffset(name) != nullptr; });
+  if (globalsStruct == 0) {
+    return false;
+  }
+
+  // offsets are literals, they are replaced in place
+  for (const auto &inst : module.GetInstructions()) {
+    if (inst.Opcode != spv::OpMemberDecorate || inst.GetOperand(0) != globalsStruct || inst.GetOperand(2) != spv::DecorationOffset) {
+      continue;
+    }
+    auto nameIt = memberNames.find({globalsStruct, inst.GetOperand(1)});
+    if (const auto *offset = nameIt != memberNames.end() ? findOffset(nameIt->second) : nullptr; offset != nullptr) {
+      spirv[inst.Words.data() - spirv.data() + 4] = offset->second;
+    }
+  }
+  return true;
+}
+
+bool getUsedUniformBufferMembers(std::span<const uint32_t> spirv, std::span<const std::string> memberNames,
+                                 std::vector<std::string> &outUsedNames) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return false;
+  }
+
+  std::unordered_set<uint32_t> blockStructs;
+  MemberNames structMemberNames;
+  getBlockMembers(module, blockStructs, structMemberNames);
+  const auto globalsStruct = findGlobalsStruct(blockStructs, structMemberNames, [&](std::string_view name) {
+    return std::ranges::find(memberNames, name) != memberNames.end();
+  });
+  if (globalsStruct == 0) {
+    return false;
+  }
+
+  std::unordered_set<uint32_t> pointers;
+  std::unordered_set<uint32_t> variables;
+  std::unordered_map<uint32_t, uint32_t> constants;
+  std::unordered_set<uint32_t> usedMembers;
+  for (const auto &inst : module.GetInstructions()) {
+    switch (inst.Opcode) {
+    case spv::OpTypePointer:
+      if (inst.GetOperand(2) == globalsStruct) {
+        pointers.insert(inst.GetOperand(0));
+      }
+      continue;
+    case spv::OpVariable:
+      if (pointers.contains(inst.GetOperand(0))) {
+        variables.insert(inst.GetOperand(1));
+      }
+      continue;
+    case spv::OpConstant:
+      constants[inst.GetOperand(1)] = inst.GetOperand(2);
+      continue;
+    case spv::OpAccessChain:
+    case spv::OpInBoundsAccessChain:
+      // only the member selected by the first index is read through the chain
+      if (variables.contains(inst.GetOperand(2))) {
+        auto constantIt = inst.GetOperandCount() > 3 ? constants.find(inst.GetOperand(3)) : constants.end();
+        if (constantIt == constants.end()) {
+          return false;
+        }
+        usedMembers.insert(constantIt->second);
+        continue;
+      }
+      break;
+    case spv::OpEntryPoint:
+      continue;
+    default:
+      if (isPointerFree(inst.Opcode) || isNameOrDecoration(inst.Opcode)) {
+        continue;
+      }
+      break;
+    }
+
+    // any other use, for example a load of the whole buffer, may read all the members
+    for (const auto operand : inst.GetOperands()) {
+      if (variables.contains(operand)) {
+        return false;
+      }
+    }
+  }
+
+  for (const auto memberIdx : usedMembers) {
+    if (auto nameIt = structMemberNames.find({globalsStruct, memberIdx}); nameIt != structMemberNames.end()) {
+      outUsedNames.emplace_back(nameIt->second);
+    }
+  }
+  std::ranges::sort(outUsedNames);
+  return true;
+}
+
+bool removeUnusedOutputs(std::vector<uint32_t> &spirv, const std::vector<std::string> &usedNames) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return false;
+  }
+  const auto &instructions = module.GetInstructions();
+
+  std::unordered_map<uint32_t, std::string_view> names;
+  std::unordered_set<uint32_t> builtIns;
+  std::vector<uint32_t> outputVariables;
+  uint32_t glslExtInstSet = 0;
+  for (const auto &inst : instructions) {
+    switch (inst.Opcode) {
+    case spv::OpName:
+      names[inst.GetOperand(0)] = inst.GetString(1);
+      break;
+    case spv::OpDecorate:
+      if (inst.GetOperand(1) == spv::DecorationBuiltIn) {
+        builtIns.insert(inst.GetOperand(0));
+      }
+      break;
+    case spv::OpExtInstImport:
+      if (inst.GetString(1) == "GLSL.std.450") {
+        glslExtInstSet = inst.GetOperand(0);
+      }
+      break;
+    case spv::OpVariable:
+      if (inst.GetOperand(2) == spv::StorageClassOutput) {
+        outputVariables.push_back(inst.GetOperand(1));
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  // removed variables, pointers into them and the unused computations
+  std::unordered_set<uint32_t> removed;
+  for (const auto id : outputVariables) {
+    auto nameIt = names.find(id);
+    if (builtIns.contains(id) || nameIt == names.end()) {
+      continue;
+    }
+    const auto lastDotPos = nameIt->second.rfind('.');
+    if (lastDotPos != std::string_view::npos && std::ranges::find(usedNames, nameIt->second.substr(lastDotPos + 1)) == usedNames.end()) {
+      removed.insert(id);
+    }
+  }
+  if (removed.empty()) {
+    return true;
+  }
+
+  std::vector<bool> keep(instructions.size(), true);
+  for (size_t i = 0; i < instructions.size(); i++) {
+    const auto &inst = instructions[i];
+    switch (inst.Opcode) {
+    case spv::OpName:
+    case spv::OpDecorate:
+    case spv::OpDecorateId:
+    case spv::OpDecorateString:
+    case spv::OpEntryPoint:
+      // filtered when the module is written
+      break;
+    case spv::OpVariable:
+      keep[i] = !removed.contains(inst.GetOperand(1));
+      break;
+    case spv::OpAccessChain:
+    case spv::OpInBoundsAccessChain:
+    case spv::OpPtrAccessChain:
+      if (removed.contains(inst.GetOperand(2))) {
+        removed.insert(inst.GetOperand(1));
+        keep[i] = false;
+      }
+      break;
+    case spv::OpStore:
+      keep[i] = !removed.contains(inst.GetOperand(0));
+      break;
+    default:
+      if (!isPointerFree(inst.Opcode)) {
+        for (auto operand : inst.GetOperands()) {
+          if (removed.contains(operand)) {
+            return false;
+          }
+        }
+      }
+      break;
+    }
+  }
+
+  // the values the dropped stores wrote, and whatever only they used
+  removeUnusedResults(instructions, glslExtInstSet, false, keep, removed);
+
+  std::vector<uint32_t> out;
+  out.reserve(spirv.size());
+  module.EmitHeader(out);
+  std::vector<uint32_t> operands;
+  for (size_t i = 0; i < instructions.size(); i++) {
+    const auto &inst = instructions[i];
+    if (!keep[i] || (isNameOrDecoration(inst.Opcode) && removed.contains(inst.GetOperand(0)))) {
+      continue;
+    }
+    if (inst.Opcode != spv::OpEntryPoint) {
+      SpirvModule::Emit(out, inst);
+      continue;
+    }
+
+    size_t nameWords = 0;
+    (void)inst.GetString(2, &nameWords);
+    const auto interfaceStart = 2 + nameWords;
+    operands.assign(inst.Words.begin() + 1, inst.Words.begin() + 1 + interfaceStart);
+    for (auto id : inst.GetOperands(interfaceStart)) {
+      if (!removed.contains(id)) {
+        operands.push_back(id);
+      }
+    }
+    SpirvModule::Emit(out, inst.Opcode, operands);
+  }
+
+  spirv = std::move(out);
+  return true;
+}
+
+bool optimizeSpirv(std::vector<uint32_t> &spirv, bool stripNames) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return false;
+  }
+  const auto &instructions = module.GetInstructions();
+
+  uint32_t glslExtInstSet = 0;
+  // the non-semantic debug info references the strings
+  bool hasDebugInfo = false;
+  for (const auto &inst : instructions) {
+    if (inst.Opcode == spv::OpExtInstImport) {
+      const auto name = inst.GetString(1);
+      glslExtInstSet = name == "GLSL.std.450" ? inst.GetOperand(0) : glslExtInstSet;
+      hasDebugInfo |= name.starts_with("NonSemantic.");
+    }
+  }
+
+  std::vector<bool> keep(instructions.size(), true);
+  for (size_t i = 0; i < instructions.size(); i++) {
+    const auto opcode = instructions[i].Opcode;
+    keep[i] = opcode != spv::OpNop && !(isDebugLocation(opcode) && !hasDebugInfo) &&
+              !(stripNames && (opcode == spv::OpName || opcode == spv::OpMemberName));
+  }
+
+  std::unordered_set<uint32_t> removed;
+  removeUnusedResults(instructions, glslExtInstSet, true, keep, removed);
+
+  std::vector<uint32_t> out;
+  out.reserve(spirv.size());
+  module.EmitHeader(out);
+  for (size_t i = 0; i < instructions.size(); i++) {
+    const auto &inst = instructions[i];
+    if (keep[i] && !(isNameOrDecoration(inst.Opcode) && removed.contains(inst.GetOperand(0)))) {
+      SpirvModule::Emit(out, inst);
+    }
+  }
+
+  spirv = std::move(out);
+  return true;
+}
+
+} // namespace BgfxSlang
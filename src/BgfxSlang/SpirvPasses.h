@@ -0,0 +1,37 @@
+#pragma once
+
+#include "UniformPacking.h"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace BgfxSlang {
+
+// Replaces uniform buffers with standalone uniform variables, one per buffer member, so SPIRV-Cross emits plain uniforms
+// expected by bgfx. std140 array wrappers are unwrapped (buffer.member.data[0] -> member[0]).
+// Members in the packing are read from its vec4 array uniform instead (u_time -> u_packed[1].w).
+// Row major matrix members are not flattened, plain uniforms can't keep the layout.
+// Returns false and leaves the module untouched when it uses a pattern the pass does not handle.
+bool flattenUniformBuffers(std::vector<uint32_t> &spirv, const UniformPacking *packing = nullptr);
+
+// Moves the members of the global uniform buffer (the block with most of the named members) to the new byte offsets.
+// Returns false when the module has no such block.
+bool setUniformBufferOffsets(std::vector<uint32_t> &spirv, std::span<const std::pair<std::string, uint32_t>> memberOffsets);
+
+// Names of the global uniform buffer members (the block with most of the named members) the module reads, sorted.
+// Returns false when the module has no such block or reads the buffer other than by access chains with a constant member index.
+bool getUsedUniformBufferMembers(std::span<const uint32_t> spirv, std::span<const std::string> memberNames,
+                                 std::vector<std::string> &outUsedNames);
+
+// Removes the vertex shader outputs the linked fragment shader doesn't read, with the stores to them and the computations only
+// the stores used. Outputs are matched by the name after the last '.' (entryPointParam_main.color -> color), built-ins are kept.
+// Returns false and leaves the module untouched when an output is used other than by stores.
+bool removeUnusedOutputs(std::vector<uint32_t> &spirv, const std::vector<std::string> &usedNames);
+
+// Size and load time passes run after slang: removes the unused computations and global constants, and the debug instructions
+// (source, lines) unless the module has non-semantic debug info. stripNames - the names are removed too, SPIRV-Cross needs them.
+bool optimizeSpirv(std::vector<uint32_t> &spirv, bool stripNames);
+
+} // namespace BgfxSlang
@@ -16,13 +16,26 @@ constexpr int vulkanVertexCBufferShift = 0;
 constexpr int vulkanFragmentCBufferShift = 1;
 constexpr int vulkanTextureShift = 2;
 constexpr int vulkanSamplerShift = 18;
+
+SlangOptimizationLevel getSlangOptimizationLevel(OptimizationLevel level) {
+  switch (level) {
+  case OptimizationLevel::None:
+    return SLANG_OPTIMIZATION_LEVEL_NONE;
+  case OptimizationLevel::Default:
+    return SLANG_OPTIMIZATION_LEVEL_DEFAULT;
+  case OptimizationLevel::High:
+    return SLANG_OPTIMIZATION_LEVEL_HIGH;
+  default:
+    return SLANG_OPTIMIZATION_LEVEL_MAXIMAL;
+  }
+}
 } // namespace
 
 std::vector<slang::CompilerOptionEntry> TargetSettings::GetCompilerOptions(StageType stage) const {
 
   std::vector<slang::CompilerOptionEntry> options(CompilerOptions.begin(), CompilerOptions.end());
   options.push_back(slang::CompilerOptionEntry{slang::CompilerOptionName::Optimization,
-                                               {.intValue0 = SlangOptimizationLevel::SLANG_OPTIMIZATION_LEVEL_MAXIMAL}});
+                                               {.intValue0 = getSlangOptimizationLevel(Optimization.Level)}});
 
   switch (Profile.Format) {
   case TargetFormat::DirectX:
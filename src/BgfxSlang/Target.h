@@ -54,11 +54,24 @@ struct TargetProfile {
   }
 };
 
+enum class OptimizationLevel { Unknown, None, Default, High, Maximal };
+
+struct TargetOptimization {
+  // slang optimization, None compiles the fastest
+  OptimizationLevel Level = OptimizationLevel::Maximal;
+  // optimizeSpirv is run on the SPIR-V before it is written (with the names stripped) or given to SPIRV-Cross
+  bool OptimizesSpirv = false;
+};
+
 struct TargetSettings {
   TargetProfile Profile;
   std::vector<slang::CompilerOptionEntry> CompilerOptions;
+  TargetOptimization Optimization;
 
   [[nodiscard]] std::vector<slang::CompilerOptionEntry> GetCompilerOptions(StageType stage) const;
+
+  // SPIR-V shifts constant buffer bindings per stage, other targets use the same options for every stage.
+  [[nodiscard]] bool HasStageOptions() const { return Profile.Format == TargetFormat::SpirV; }
 };
 
 constexpr std::array targetProfiles = {
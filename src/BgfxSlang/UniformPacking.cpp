@@ -0,0 +1,80 @@
+#include "UniformPacking.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlang {
+
+const PackedUniformField *UniformPacking::Find(std::string_view name) const {
+  const auto it = std::ranges::find(Fields, name, &PackedUniformField::Name);
+  return it != Fields.end() ? &*it : nullptr;
+}
+
+UniformPacking packUniforms(std::string_view name, std::span<const UniformToPack> uniforms) {
+  UniformPacking packing;
+  packing.Name = name;
+  packing.Fields.resize(uniforms.size());
+
+  std::vector<size_t> order(uniforms.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, [&](size_t a, size_t b) { return uniforms[a].ComponentCount > uniforms[b].ComponentCount; });
+
+  // bit per used component of every register
+  std::vector<uint8_t> usedComponents;
+  for (const auto idx : order) {
+    const auto &uniform = uniforms[idx];
+    const uint32_t count = std::clamp<uint32_t>(uniform.ComponentCount, 1, uniformRegisterComponents - 1);
+    const uint32_t step = count == 3 ? uniformRegisterComponents : count;
+    const auto mask = static_cast<uint8_t>((1U << count) - 1);
+
+    size_t reg = 0;
+    uint32_t component = 0;
+    for (; reg < usedComponents.size(); reg++) {
+      for (component = 0; component + count <= uniformRegisterComponents; component += step) {
+        if ((usedComponents[reg] & (mask << component)) == 0) {
+          break;
+        }
+      }
+      if (component + count <= uniformRegisterComponents) {
+        break;
+      }
+    }
+    if (reg == usedComponents.size()) {
+      usedComponents.push_back(0);
+      component = 0;
+    }
+    usedComponents[reg] |= static_cast<uint8_t>(mask << component);
+
+    packing.Fields[idx] = {uniform.Name, static_cast<uint16_t>(reg), static_cast<uint8_t>(component), static_cast<uint8_t>(count)};
+  }
+
+  packing.RegisterCount = static_cast<uint16_t>(usedComponents.size());
+  return packing;
+}
+
+std::string formatPackedUniformsHeader(const UniformPacking &packing, std::string_view namespaceName) {
+  static constexpr std::string_view typeNames[] = {"float", "float2", "float3"};
+
+  std::string header = "// Generated by bgfx-slang, do not edit.\n#pragma once\n\n#include <cstdint>\n\nnamespace ";
+  header += namespaceName;
+  header += " {\n\n// bgfx::createUniform(PackedUniformName, bgfx::UniformType::Vec4, PackedRegisterCount)\n";
+  header += "constexpr const char *PackedUniformName = \"" + packing.Name + "\";\n";
+  header += "constexpr uint16_t PackedRegisterCount = " + std::to_string(packing.RegisterCount) + ";\n";
+  header += "constexpr uint32_t PackedFloatCount = PackedRegisterCount * 4;\n\n";
+  header += "// index of the first float of the uniform in the packed data\n";
+  for (const auto &field : packing.Fields) {
+    header += "constexpr uint32_t " + field.Name + " = " + std::to_string(field.GetFloatIndex()) + "; // " +
+              std::string(typeNames[field.ComponentCount - 1]) + "\n";
+  }
+  header += "\n} // namespace ";
+  header += namespaceName;
+  header += "\n";
+  return header;
+}
+
+} // namespace BgfxSlang
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlang {
+
+constexpr uint32_t uniformRegisterComponents = 4;
+
+struct PackedUniformField {
+  std::string Name;
+  uint16_t Register;
+  uint8_t Component;
+  // 1 - float, 2 - float2, 3 - float3
+  uint8_t ComponentCount;
+
+  // Index of the first float in the packed data (float4 array).
+  [[nodiscard]] uint32_t GetFloatIndex() const { return Register * uniformRegisterComponents + Component; }
+};
+
+struct UniformToPack {
+  std::string Name;
+  uint8_t ComponentCount;
+};
+
+// Global float, float2 and float3 uniforms of a program packed into one bgfx vec4 array uniform, so the application uploads them
+// with a single setUniform. The packing is the same for all the targets and stages of the program.
+struct UniformPacking {
+  // name of the bgfx uniform with the packed registers
+  std::string Name;
+  uint16_t RegisterCount = 0;
+  // in declaration order
+  std::vector<PackedUniformField> Fields;
+
+  [[nodiscard]] bool IsEmpty() const { return Fields.empty(); }
+  [[nodiscard]] const PackedUniformField *Find(std::string_view name) const;
+};
+
+// Packs the uniforms into the fewest vec4 registers: the largest first, each into the first register with enough free components.
+// float3 starts at component 0 and float2 at an even component, so the layout follows std140 as well.
+UniformPacking packUniforms(std::string_view name, std::span<const UniformToPack> uniforms);
+
+// C++ header with the float index of every packed uniform and the register count, in the namespace.
+std::string formatPackedUniformsHeader(const UniformPacking &packing, std::string_view namespaceName);
+
+} // namespace BgfxSlang
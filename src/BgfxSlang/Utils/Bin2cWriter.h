@@ -1,84 +1,202 @@
 #pragma once
 
 #include "FileWriter.h"
+#include <algorithm>
+#include <array>
 #include <cctype>
 #include <cstddef>
 #include <cstdint>
-#include <fstream>
-#include <iomanip>
-#include <ios>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <memory>
 #include <string>
 #include <string_view>
-#include <vector>
 
 namespace BgfxSlang {
 
+enum class Bin2cFormat {
+  // uint8_t array with ASCII representation of every line in comment
+  Ascii,
+  // uint8_t array
+  Bytes,
+  // uint32_t array of little endian words, the data size in bytes is in <name>_size constant
+  Words,
+  // uint8_t array initialized with #embed of the binary file written next to the header
+  Embed,
+
+  Unknown,
+};
+
+inline Bin2cFormat getBin2cFormatFromName(std::string_view name) {
+  if (name == "ascii") {
+    return Bin2cFormat::Ascii;
+  }
+  if (name == "bytes") {
+    return Bin2cFormat::Bytes;
+  }
+  if (name == "words") {
+    return Bin2cFormat::Words;
+  }
+  if (name == "embed") {
+    return Bin2cFormat::Embed;
+  }
+  return Bin2cFormat::Unknown;
+}
+
 class Bin2cWriter : public FileWriter {
 public:
-  explicit Bin2cWriter(std::string_view varName) : varName(varName) {};
+  explicit Bin2cWriter(std::string_view varName, Bin2cFormat format = Bin2cFormat::Ascii) : varName(varName), format(format) {};
   ~Bin2cWriter() override {
-    if (file.is_open()) {
-      Close();
-    };
+    if (IsOpen()) {
+      Bin2cWriter::Close();
+    }
   }
 
-  inline bool Open(const std::string_view &path) override {
-
-    if (file.is_open()) {
+  inline bool Close() override {
+    if (!IsOpen()) {
       return false;
     }
 
-    file.open(path.data(), std::ios::binary);
+    bool succeeded = true;
+    bool dataUnchanged = true;
+    std::string embedPath;
+    if (format == Bin2cFormat::Embed) {
+      const auto dataPath = GetEmbedDataPath(getPath());
+      succeeded = writeIfChanged(dataPath, buffer.data(), buffer.size(), dataUnchanged);
+      embedPath = std::filesystem::path(dataPath).filename().generic_string();
+    }
 
-    return file.is_open();
-  };
+    const auto content = Encode(varName, format, buffer, embedPath);
+    succeeded = commit(content.data(), content.size()) && succeeded;
+    unchanged = unchanged && dataUnchanged;
+    return succeeded;
+  }
 
-  inline void Close() override {
-    writeContentToFile();
-    file.close();
+  // Binary file included by the Embed format header: the header path without ".h", or with ".bin" appended for other extensions.
+  static std::string GetEmbedDataPath(std::string_view headerPath) {
+    if (headerPath.ends_with(".h")) {
+      return std::string(headerPath.substr(0, headerPath.size() - 2));
+    }
+    return std::string(headerPath) + ".bin";
+  }
+
+  // Header source declaring the data, embedPath is the file name used by the Embed format.
+  static std::string Encode(std::string_view varName, Bin2cFormat format, std::span<const uint8_t> data, std::string_view embedPath = {}) {
+    switch (format) {
+    case Bin2cFormat::Words:
+      return encodeWords(varName, data);
+    case Bin2cFormat::Embed:
+      return "static const uint8_t " + std::string(varName) + "[] =\n{\n#embed \"" + std::string(embedPath) + "\"\n};\n";
+    case Bin2cFormat::Bytes:
+      return encodeBytes(varName, data, false);
+    default:
+      return encodeBytes(varName, data, true);
+    }
   }
 
 private:
   std::string varName;
-  std::vector<uint8_t> buffer;
-  std::ofstream file;
+  Bin2cFormat format;
+
+  // the encoder reads one contiguous buffer
+  void writeShared(std::span<const uint8_t> data, std::shared_ptr<const void> /*owner*/) override { Write(data.data(), data.size()); }
   constexpr static size_t bytesPerLine = 16;
+  constexpr static size_t wordsPerLine = 8;
+  // "0xNN, "
+  constexpr static size_t byteItemSize = 6;
+  // "0xNNNNNNNN, "
+  constexpr static size_t wordItemSize = 12;
+
+  // two lowercase hex digits of every byte value
+  static constexpr std::array<char, 512> makeHexTable() {
+    constexpr std::string_view digits = "0123456789abcdef";
+    std::array<char, 512> table{};
+    for (size_t i = 0; i < 256; i++) {
+      table[i * 2] = digits[i >> 4];
+      table[i * 2 + 1] = digits[i & 0xf];
+    }
+    return table;
+  }
 
-  void write(const void *data, size_t size) override {
-    const auto *ptr = static_cast<const uint8_t *>(data);
-    buffer.insert(buffer.end(), ptr, ptr + size);
+  static char *appendHex(char *out, uint8_t value) {
+    static constexpr auto hexTable = makeHexTable();
+    std::memcpy(out, &hexTable[value * 2], 2);
+    return out + 2;
   }
 
-  void writeContentToFile() {
-    auto size = buffer.size();
-    file << "static const uint8_t " << varName << "[" << size << "] =\n{\n";
+  static char *append(char *out, std::string_view str) {
+    std::memcpy(out, str.data(), str.size());
+    return out + str.size();
+  }
 
-    for (size_t i = 0; i < buffer.size(); i += bytesPerLine) {
-      file << "  ";
-      for (size_t j = i; j < i + bytesPerLine && j < buffer.size(); ++j) {
-        file << "0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(buffer[j]) << ", ";
+  // The output is written into a buffer sized for the longest lines and trimmed at the end.
+  static std::string encodeBytes(std::string_view varName, std::span<const uint8_t> data, bool withAscii) {
+    const auto declaration = "static const uint8_t " + std::string(varName) + "[" + std::to_string(data.size()) + "] =\n{\n";
+    const size_t lineCount = (data.size() + bytesPerLine - 1) / bytesPerLine;
+    const size_t maxLineSize = 2 + bytesPerLine * byteItemSize + (withAscii ? 3 + bytesPerLine : 0) + 1;
+
+    std::string content(declaration.size() + lineCount * maxLineSize + 3, '\0');
+    char *out = append(content.data(), declaration);
+
+    for (size_t i = 0; i < data.size(); i += bytesPerLine) {
+      const size_t lineEnd = std::min(i + bytesPerLine, data.size());
+      out = append(out, "  ");
+      for (size_t j = i; j < lineEnd; j++) {
+        out = append(out, "0x");
+        out = appendHex(out, data[j]);
+        out = append(out, ", ");
       }
 
-      // Optionally add spacing if the last line has fewer than 16 bytes.
-      size_t bytesInLine = ((i + bytesPerLine) <= buffer.size()) ? bytesPerLine : (buffer.size() - i);
-      if (bytesInLine < bytesPerLine) {
-        int missing = static_cast<int>(bytesPerLine - bytesInLine);
-        const auto missingSpaces = std::string(missing * 6, ' ');
-        file << missingSpaces;
+      if (!withAscii) {
+        out[-1] = '\n';
+        continue;
       }
 
-      // write ASCII representation
-      file << "// ";
-      for (size_t j = i; j < i + bytesPerLine && j < buffer.size(); ++j) {
-        auto c = buffer[j];
-        file << (std::isprint(c) != 0 ? static_cast<char>(c) : '.');
+      // the comments of the last line are aligned with the full lines
+      const size_t padding = (bytesPerLine - (lineEnd - i)) * byteItemSize;
+      std::memset(out, ' ', padding);
+      out += padding;
+      out = append(out, "// ");
+      for (size_t j = i; j < lineEnd; j++) {
+        *out++ = std::isprint(data[j]) != 0 ? static_cast<char>(data[j]) : '.';
       }
+      *out++ = '\n';
+    }
 
-      file << "\n";
+    out = append(out, "};\n");
+    content.resize(out - content.data());
+    return content;
+  }
+
+  static std::string encodeWords(std::string_view varName, std::span<const uint8_t> data) {
+    const size_t wordCount = (data.size() + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    const auto declaration = "static const uint32_t " + std::string(varName) + "[" + std::to_string(wordCount) + "] =\n{\n";
+    const auto sizeDeclaration = "static const uint32_t " + std::string(varName) + "_size = " + std::to_string(data.size()) + ";\n";
+    const size_t lineCount = (wordCount + wordsPerLine - 1) / wordsPerLine;
+
+    std::string content(declaration.size() + lineCount * (2 + wordsPerLine * wordItemSize) + 3 + sizeDeclaration.size(), '\0');
+    char *out = append(content.data(), declaration);
+
+    for (size_t i = 0; i < wordCount; i += wordsPerLine) {
+      out = append(out, "  ");
+      for (size_t word = i; word < std::min(i + wordsPerLine, wordCount); word++) {
+        // little endian, the most significant byte is the last one, missing bytes of the last word are zero
+        out = append(out, "0x");
+        for (size_t byte = sizeof(uint32_t); byte-- > 0;) {
+          const size_t idx = word * sizeof(uint32_t) + byte;
+          out = appendHex(out, idx < data.size() ? data[idx] : 0);
+        }
+        out = append(out, ", ");
+      }
+      out[-1] = '\n';
     }
 
-    file << "};\n";
+    out = append(out, "};\n");
+    out = append(out, sizeDeclaration);
+    content.resize(out - content.data());
+    return content;
   }
 };
 
-} // namespace BgfxSlang
\ No newline at end of file
+} // namespace BgfxSlang
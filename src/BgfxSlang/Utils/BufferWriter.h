@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <span>
+#include <utility>
 #include <vector>
 
 namespace BgfxSlang {
@@ -12,6 +13,7 @@ class BufferWriter : public IWriter {
 public:
   std::span<uint8_t> GetData() { return buffer; }
   void Clear() { buffer.clear(); }
+  std::vector<uint8_t> Detach() { return std::move(buffer); }
 
 private:
   std::vector<uint8_t> buffer;
@@ -20,6 +22,8 @@ private:
     const auto *ptr = static_cast<const uint8_t *>(data);
     buffer.insert(buffer.end(), ptr, ptr + size);
   }
+
+  void reserve(size_t size) override { buffer.reserve(buffer.size() + size); }
 };
 
 } // namespace BgfxSlang
\ No newline at end of file
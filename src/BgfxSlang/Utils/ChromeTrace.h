@@ -0,0 +1,85 @@
+#pragma once
+
+#include "IWriter.h"
+#include "Trace.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace BgfxSlang {
+
+// Records the spans with their threads and writes them as Chrome trace event JSON, viewable in chrome://tracing or
+// ui.perfetto.dev. Threads are numbered in the order of their first span, timestamps are relative to the sink creation.
+class ChromeTraceSink : public ITraceSink {
+public:
+  ChromeTraceSink() : originNs(GetTimeNs()) {}
+
+  void AddSpan(std::string_view name, uint64_t startNs, uint64_t durationNs) override {
+    const auto threadId = std::this_thread::get_id();
+    std::lock_guard lock(mutex);
+    size_t threadIdx = 0;
+    while (threadIdx < threads.size() && threads[threadIdx] != threadId) {
+      threadIdx++;
+    }
+    if (threadIdx == threads.size()) {
+      threads.push_back(threadId);
+    }
+    events.push_back({std::string(name), threadIdx, startNs > originNs ? startNs - originNs : 0, durationNs});
+  }
+
+  void WriteTo(IWriter &writer) {
+    std::lock_guard lock(mutex);
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < threads.size(); i++) {
+      const auto tid = std::to_string(i);
+      json += R"({"name":"thread_name","ph":"M","pid":1,"tid":)" + tid + R"(,"args":{"name":"thread )" + tid + "\"}},\n";
+    }
+    for (const auto &event : events) {
+      json += R"({"name":")";
+      appendEscaped(json, event.Name);
+      json += R"(","ph":"X","pid":1,"tid":)" + std::to_string(event.ThreadIdx) + ",\"ts\":";
+      appendMicroseconds(json, event.StartNs);
+      json += ",\"dur\":";
+      appendMicroseconds(json, event.DurationNs);
+      json += "},\n";
+    }
+    // the last event is followed by a comma, the metadata event closes the list
+    json += R"({"name":"process_name","ph":"M","pid":1,"args":{"name":"bgfx-slang"}}]})";
+    json += '\n';
+    writer.Write(json.data(), json.size());
+  }
+
+private:
+  struct Event {
+    std::string Name;
+    size_t ThreadIdx;
+    uint64_t StartNs;
+    uint64_t DurationNs;
+  };
+
+  std::mutex mutex;
+  uint64_t originNs;
+  std::vector<std::thread::id> threads;
+  std::vector<Event> events;
+
+  // trace event timestamps are microseconds, the fraction keeps the nanoseconds
+  static void appendMicroseconds(std::string &json, uint64_t ns) {
+    const auto fraction = std::to_string(ns % 1000);
+    json += std::to_string(ns / 1000) + "." + std::string(3 - fraction.size(), '0') + fraction;
+  }
+
+  static void appendEscaped(std::string &json, std::string_view value) {
+    for (const auto c : value) {
+      if (c == '"' || c == '\\') {
+        json += '\\';
+      }
+      json += c;
+    }
+  }
+};
+
+} // namespace BgfxSlang
@@ -1,40 +1,217 @@
 #pragma once
 
 #include "IWriter.h"
+#include "TempPath.h"
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <ios>
+#include <memory>
+#include <span>
+#include <string>
 #include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 namespace BgfxSlang {
 
+// Buffers the data and writes the file on Close. The file is left untouched when it already has the same content, so its
+// timestamp doesn't trigger the steps depending on it, changed content replaces the file atomically. Data written with WriteShared
+// is referenced, not copied, and written together with the buffered data by a single writev.
 class FileWriter : public IWriter {
 
 public:
   explicit FileWriter() = default;
   ~FileWriter() override {
-    if (file.is_open()) {
-      file.close();
+    if (isOpen) {
+      FileWriter::Close();
     }
   };
 
   inline bool virtual Open(const std::string_view &path) {
 
-    if (file.is_open()) {
+    if (isOpen) {
       return false;
     }
 
-    file.open(path.data(), std::ios::binary);
-
-    return file.is_open();
+    filePath = path;
+    buffer.clear();
+    sharedParts.clear();
+    isOpen = true;
+    unchanged = false;
+    return true;
   };
 
-  inline void virtual Close() { file.close(); }
+  // Returns false when the file could not be written.
+  inline bool virtual Close() {
+    // the buffered data between the shared parts, in the written order
+    std::vector<std::span<const uint8_t>> parts;
+    size_t offset = 0;
+    for (const auto &part : sharedParts) {
+      parts.emplace_back(buffer.data() + offset, part.Offset - offset);
+      parts.push_back(part.Data);
+      offset = part.Offset;
+    }
+    parts.emplace_back(buffer.data() + offset, buffer.size() - offset);
+
+    const bool succeeded = commit(parts);
+    sharedParts.clear();
+    return succeeded;
+  }
+
+  // Drops the buffered data, the file is not written.
+  inline void Discard() {
+    isOpen = false;
+    buffer.clear();
+    sharedParts.clear();
+  }
+
+  [[nodiscard]] bool IsOpen() const { return isOpen; }
+  // True when the last Close found the file with the same content and skipped writing it.
+  [[nodiscard]] bool IsUnchanged() const { return unchanged; }
+
+protected:
+  std::vector<uint8_t> buffer;
+  bool unchanged = false;
+
+  [[nodiscard]] const std::string &getPath() const { return filePath; }
+
+  bool commit(const void *data, size_t size) {
+    const std::span<const uint8_t> part{static_cast<const uint8_t *>(data), size};
+    return commit({&part, 1});
+  }
+
+  bool commit(std::span<const std::span<const uint8_t>> parts) {
+    if (!isOpen) {
+      return false;
+    }
+    isOpen = false;
+    return writeIfChanged(filePath, parts, unchanged);
+  }
+
+  // Returns false when the file could not be written.
+  static bool writeIfChanged(const std::string &path, const void *data, size_t size, bool &outUnchanged) {
+    const std::span<const uint8_t> part{static_cast<const uint8_t *>(data), size};
+    return writeIfChanged(path, {&part, 1}, outUnchanged);
+  }
+
+  // The file content is the parts one after another. Returns false when the file could not be written.
+  static bool writeIfChanged(const std::string &path, std::span<const std::span<const uint8_t>> parts, bool &outUnchanged) {
+    outUnchanged = false;
+    size_t size = 0;
+    for (const auto &part : parts) {
+      size += part.size();
+    }
+
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) == size && !error) {
+      std::vector<uint8_t> existing(size);
+      std::ifstream file(path, std::ios::binary);
+      if (file.read(reinterpret_cast<char *>(existing.data()), static_cast<std::streamsize>(size))) {
+        size_t offset = 0;
+        outUnchanged = true;
+        for (const auto &part : parts) {
+          outUnchanged = outUnchanged && (part.empty() || std::memcmp(existing.data() + offset, part.data(), part.size()) == 0);
+          offset += part.size();
+        }
+        if (outUnchanged) {
+          return true;
+        }
+      }
+    }
+
+    // written next to the file and renamed over it, so an application reloading the file never sees it half written
+    const auto tempPath = makeTempPath(path).string();
+    if (writeParts(tempPath, parts)) {
+      std::filesystem::rename(tempPath, path, error);
+      if (!error) {
+        return true;
+      }
+    }
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
 
 private:
-  void write(const void *data, size_t size) override { file.write(static_cast<const char *>(data), size); }
+  // data referenced by WriteShared, written before the buffer data from Offset on
+  struct SharedPart {
+    size_t Offset;
+    std::span<const uint8_t> Data;
+    std::shared_ptr<const void> Owner;
+  };
+
+  std::string filePath;
+  bool isOpen = false;
+  std::vector<SharedPart> sharedParts;
+
+  void write(const void *data, size_t size) override {
+    const auto *ptr = static_cast<const uint8_t *>(data);
+    buffer.insert(buffer.end(), ptr, ptr + size);
+  }
+
+  void reserve(size_t size) override { buffer.reserve(buffer.size() + size); }
+
+  void writeShared(std::span<const uint8_t> data, std::shared_ptr<const void> owner) override {
+    sharedParts.push_back({buffer.size(), data, std::move(owner)});
+  }
 
-  std::ofstream file;
+  // All the parts with one writev, the stream writes them one by one on Windows.
+  static bool writeParts(const std::string &path, std::span<const std::span<const uint8_t>> parts) {
+#ifdef _WIN32
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(nullptr, 0);
+    file.open(path, std::ios::binary | std::ios::trunc);
+    for (const auto &part : parts) {
+      file.write(reinterpret_cast<const char *>(part.data()), static_cast<std::streamsize>(part.size()));
+    }
+    file.close();
+    return !file.fail();
+#else
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+      return false;
+    }
+
+    std::vector<iovec> vectors;
+    vectors.reserve(parts.size());
+    for (const auto &part : parts) {
+      if (!part.empty()) {
+        vectors.push_back({const_cast<uint8_t *>(part.data()), part.size()});
+      }
+    }
+
+    // a short write continues from the first part not fully written
+    bool succeeded = true;
+    size_t first = 0;
+    while (succeeded && first < vectors.size()) {
+      const auto count = std::min<size_t>(vectors.size() - first, IOV_MAX);
+      auto written = ::writev(fd, vectors.data() + first, static_cast<int>(count));
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      succeeded = written > 0;
+      for (; succeeded && first < vectors.size() && static_cast<size_t>(written) >= vectors[first].iov_len; first++) {
+        written -= static_cast<ssize_t>(vectors[first].iov_len);
+      }
+      if (succeeded && written > 0) {
+        vectors[first].iov_base = static_cast<uint8_t *>(vectors[first].iov_base) + written;
+        vectors[first].iov_len -= written;
+      }
+    }
+    return ::close(fd) == 0 && succeeded;
+#endif
+  }
 };
 
-} // namespace BgfxSlang
\ No newline at end of file
+} // namespace BgfxSlang
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace BgfxSlang {
+
+// FNV-1a, specified bit for bit, so the hashes written to the shaders and packs are the same on every host and standard library.
+constexpr uint32_t fnv1a32Offset = 0x811c9dc5U;
+constexpr uint32_t fnv1a32Prime = 0x01000193U;
+constexpr uint64_t fnv1a64Offset = 0xcbf29ce484222325ULL;
+constexpr uint64_t fnv1a64Prime = 0x100000001b3ULL;
+
+constexpr uint32_t fnv1a32(std::string_view data, uint32_t hash = fnv1a32Offset) {
+  for (const auto c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= fnv1a32Prime;
+  }
+  return hash;
+}
+
+constexpr uint64_t fnv1a64(std::string_view data, uint64_t hash = fnv1a64Offset) {
+  for (const auto c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= fnv1a64Prime;
+  }
+  return hash;
+}
+
+// reference values of the FNV specification
+static_assert(fnv1a32("") == 0x811c9dc5U && fnv1a32("a") == 0xe40c292cU && fnv1a32("foobar") == 0xbf9cf968U);
+static_assert(fnv1a64("") == 0xcbf29ce484222325ULL && fnv1a64("a") == 0xaf63dc4c8601ec8cULL && fnv1a64("foobar") == 0x85944171f73967e8ULL);
+
+} // namespace BgfxSlang
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <string_view>
 #include <type_traits>
+#include <utility>
 
 namespace BgfxSlang {
 
@@ -20,8 +24,17 @@ public:
 
   inline void Write(const void *data, size_t size) { write(data, size); }
 
+  // Data kept alive by owner (or by the caller when it is null) until the writer is done with it. Writers sending the data to a file
+  // on close reference it instead of copying, the others copy it.
+  inline void WriteShared(std::span<const uint8_t> data, std::shared_ptr<const void> owner) { writeShared(data, std::move(owner)); }
+
+  // Size of the data about to be written, buffering writers use it to allocate once.
+  inline void Reserve(size_t size) { reserve(size); }
+
 private:
   virtual void write(const void *data, size_t size) = 0;
+  virtual void reserve(size_t /*size*/) {}
+  virtual void writeShared(std::span<const uint8_t> data, std::shared_ptr<const void> /*owner*/) { write(data.data(), data.size()); }
 };
 
 } // namespace BgfxSlang
\ No newline at end of file
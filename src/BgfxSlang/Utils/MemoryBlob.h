@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <slang-com-ptr.h>
+#include <slang.h>
+#include <utility>
+#include <vector>
+
+namespace BgfxSlang {
+
+// Immutable slang blob owning its data, used to hand data loaded from disk back to slang.
+class MemoryBlob : public ISlangBlob {
+public:
+  static Slang::ComPtr<ISlangBlob> Create(std::vector<uint8_t> data) { return Slang::ComPtr<ISlangBlob>(new MemoryBlob(std::move(data))); }
+
+  SLANG_NO_THROW SlangResult SLANG_MCALL queryInterface(SlangUUID const &uuid, void **outObject) override {
+    if (uuid == ISlangUnknown::getTypeGuid() || uuid == ISlangBlob::getTypeGuid()) {
+      addRef();
+      *outObject = static_cast<ISlangBlob *>(this);
+      return SLANG_OK;
+    }
+    return SLANG_E_NO_INTERFACE;
+  }
+
+  SLANG_NO_THROW uint32_t SLANG_MCALL addRef() override { return ++refCount; }
+
+  SLANG_NO_THROW uint32_t SLANG_MCALL release() override {
+    const auto count = --refCount;
+    if (count == 0) {
+      delete this;
+    }
+    return count;
+  }
+
+  SLANG_NO_THROW const void *SLANG_MCALL getBufferPointer() override { return data.data(); }
+  SLANG_NO_THROW size_t SLANG_MCALL getBufferSize() override { return data.size(); }
+
+private:
+  explicit MemoryBlob(std::vector<uint8_t> data) : data(std::move(data)) {}
+  virtual ~MemoryBlob() = default;
+
+  std::vector<uint8_t> data;
+  std::atomic<uint32_t> refCount = 0;
+};
+
+} // namespace BgfxSlang
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <random>
+
+namespace BgfxSlang {
+
+// Path next to the given one for writing a file that is renamed over it afterwards. The random suffix keeps the temporary files of
+// other threads and processes writing the same path apart.
+inline std::filesystem::path makeTempPath(const std::filesystem::path &path) {
+  thread_local std::mt19937_64 generator{(static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}()};
+  auto tempPath = path;
+  tempPath += std::format(".{:016x}.tmp", generator());
+  return tempPath;
+}
+
+} // namespace BgfxSlang
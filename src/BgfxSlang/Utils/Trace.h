@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace BgfxSlang {
+
+// Receives the timed phases of the compilation (session, module-load, link, reflection, codegen, spirv-cross, glsl-rewrite, write).
+// Spans are added from the compile worker threads, implementations must be thread safe.
+class ITraceSink {
+public:
+  virtual ~ITraceSink() = default;
+
+  // Start is steady clock time in nanoseconds, spans of one thread are nested (inner spans end before the outer ones).
+  virtual void AddSpan(std::string_view name, uint64_t startNs, uint64_t durationNs) = 0;
+
+  static uint64_t GetTimeNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+// Adds the span of its lifetime to the sink. Without a sink the clock is not read at all.
+class ScopedSpan {
+public:
+  ScopedSpan(ITraceSink *sink, std::string_view name) : sink(sink), name(name), startNs(sink != nullptr ? ITraceSink::GetTimeNs() : 0) {}
+  ~ScopedSpan() {
+    if (sink != nullptr) {
+      sink->AddSpan(name, startNs, ITraceSink::GetTimeNs() - startNs);
+    }
+  }
+  ScopedSpan(const ScopedSpan &) = delete;
+  ScopedSpan &operator=(const ScopedSpan &) = delete;
+  ScopedSpan(ScopedSpan &&) = delete;
+  ScopedSpan &operator=(ScopedSpan &&) = delete;
+
+private:
+  ITraceSink *sink;
+  std::string_view name;
+  uint64_t startNs;
+};
+
+} // namespace BgfxSlang
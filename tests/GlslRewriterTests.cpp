@@ -0,0 +1,63 @@
+#include "BgfxSlang/GlslRewriter.h"
+#include "Tests.h"
+#include <string>
+#include <string_view>
+
+namespace BgfxSlangTests {
+
+namespace {
+// uniform buffer as SPIRV-Cross writes it, with a std140 array wrapper member
+constexpr std::string_view bufferSource = R"(struct _Array_std140_vector_float_4
+{
+    vec4 data[4];
+};
+
+struct GlobalParams
+{
+    vec4 u_color;
+    _Array_std140_vector_float_4 u_lights;
+};
+
+uniform GlobalParams globalParams;
+
+void main()
+{
+    gl_Position = globalParams.u_lights.data[int(globalParams.u_color.x)] * globalParams.u_color * 1.0e5;
+    vec4 other = otherParams.u_color + globalParamsCopy.u_color + u_color;
+}
+)";
+
+constexpr std::string_view rewrittenSource = R"(struct _Array_std140_vector_float_4
+{
+    vec4 data[4];
+};
+
+struct GlobalParams
+{
+    vec4 u_color;
+    _Array_std140_vector_float_4 u_lights;
+};
+
+uniform vec4 u_color;
+uniform vec4 u_lights[4];
+
+void main()
+{
+    gl_Position = u_lights[int(u_color.x)] * u_color * 1.0e5;
+    vec4 other = otherParams.u_color + globalParamsCopy.u_color + u_color;
+}
+)";
+} // namespace
+
+void testRewriteUniformBuffers(TestContext &context) {
+  const BgfxSlang::UniformBufferRewrite buffers[] = {{
+      .TypeName = "GlobalParams",
+      .Name = "globalParams",
+      .Members = {{"u_color", false}, {"u_lights", true}},
+      .Declarations = "uniform vec4 u_color;\nuniform vec4 u_lights[4];\n",
+  }};
+  const auto glsl = BgfxSlang::rewriteUniformBuffers(bufferSource, buffers);
+  context.Check(glsl == rewrittenSource, "Unexpected rewritten GLSL:\n" + glsl);
+}
+
+} // namespace BgfxSlangTests
@@ -0,0 +1,627 @@
+#include "BgfxSlang/SpirvModule.h"
+#include "BgfxSlang/SpirvPasses.h"
+#include "BgfxSlang/Target.h"
+#include "BgfxSlang/Types.h"
+#include "BgfxSlang/UniformPacking.h"
+#include "Tests.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <map>
+#include <slang-com-ptr.h>
+#include <slang.h>
+#include <span>
+#include <spirv_glsl.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace BgfxSlangTests {
+
+namespace {
+using BgfxSlang::SpirvModule;
+
+constexpr uint32_t glslVersion = 440;
+
+// slang names the layouts after HLSL, row_major matrices are column major in SPIR-V and GLSL and the other way around
+constexpr const char *columnMajorMatrices = R"(
+uniform row_major float4x4 u_modelViewProj;
+uniform row_major float3x3 u_normalMatrix;
+)";
+
+// the layout of the compiler session
+constexpr const char *rowMajorMatrices = R"(
+uniform column_major float4x4 u_modelViewProj;
+uniform column_major float3x3 u_normalMatrix;
+)";
+
+constexpr const char *matrixMain = R"(
+struct Vertex {
+  float4 sv_position : SV_Position;
+  float3 normal : NORMAL;
+};
+
+[shader("vertex")]
+Vertex vertexMain(float3 position : POSITION, float3 normal : NORMAL) {
+  Vertex output;
+  output.sv_position = mul(u_modelViewProj, float4(position, 1.0));
+  output.normal = mul(u_normalMatrix, normal);
+  return output;
+}
+)";
+
+constexpr const char *arrayWrapperSource = R"(
+uniform float4 u_lights[4];
+uniform float4 u_color;
+
+[shader("vertex")]
+float4 vertexMain(float4 position : POSITION) : SV_Position {
+  return float4(position.xyz, 1.0) * u_lights[int(position.w)] + u_lights[2] * u_color;
+}
+)";
+
+constexpr const char *packedSource = R"(
+uniform float u_time;
+uniform float2 u_offset;
+uniform float3 u_direction;
+uniform float4 u_color;
+
+[shader("vertex")]
+float4 vertexMain(float3 position : POSITION) : SV_Position {
+  return float4(position + u_direction * u_time + float3(u_offset, 0.0), 1.0) * u_color;
+}
+)";
+
+constexpr const char *outputsSource = R"(
+struct Vertex {
+  float4 sv_position : SV_Position;
+  float4 v_color : COLOR;
+  float2 v_unusedUv : TEXCOORD0;
+};
+
+[shader("vertex")]
+Vertex vertexMain(float3 position : POSITION, float4 color : COLOR) {
+  Vertex output;
+  output.sv_position = float4(position, 1.0);
+  output.v_color = color;
+  output.v_unusedUv = position.xy * 0.5 + 0.5;
+  return output;
+}
+)";
+
+// two of the four uniforms are read
+constexpr const char *partlyUsedSource = R"(
+uniform float4 u_color;
+uniform float4 u_unusedTint;
+uniform float4 u_offset;
+uniform float4 u_unusedScale;
+
+[shader("vertex")]
+float4 vertexMain(float4 position : POSITION) : SV_Position {
+  return position * u_color + u_offset;
+}
+)";
+
+// only the whole part of modf is read, the call stores it through the pointer operand
+constexpr const char *modfSource = R"(
+[shader("vertex")]
+float4 vertexMain(float4 position : POSITION) : SV_Position {
+  float whole;
+  modf(position.x, whole);
+  return float4(position.xyz, whole);
+}
+)";
+
+// ids of the hand written modules, the instructions added by the tests use the ids from FirstFree up to Bound
+namespace BlockIds {
+constexpr uint32_t Main = 1;
+constexpr uint32_t Void = 2;
+constexpr uint32_t MainType = 3;
+constexpr uint32_t Float = 4;
+constexpr uint32_t Vec4 = 5;
+constexpr uint32_t Int = 6;
+constexpr uint32_t Block = 7;
+constexpr uint32_t BlockPointer = 8;
+constexpr uint32_t Globals = 9;
+constexpr uint32_t Vec4Pointer = 10;
+constexpr uint32_t OutputPointer = 11;
+constexpr uint32_t Position = 12;
+constexpr uint32_t Label = 13;
+// constant i of the int type, for the first eight members
+constexpr uint32_t MemberIndex = 16;
+constexpr uint32_t FirstFree = 32;
+constexpr uint32_t Bound = 64;
+} // namespace BlockIds
+
+constexpr std::string_view blockMemberNames[] = {"u_color", "u_offset", "u_scale"};
+
+struct BlockModuleParts {
+  // debug instructions before the names
+  std::vector<uint32_t> Debug;
+  // types, constants and variables declared after the uniform block
+  std::vector<uint32_t> Globals;
+  // instructions of the entry point after its label, they store a float4 to BlockIds::Position
+  std::vector<uint32_t> Body;
+  // functions defined after the entry point
+  std::vector<uint32_t> Functions;
+};
+
+void appendString(std::vector<uint32_t> &words, std::string_view text) {
+  const auto first = words.size();
+  words.resize(first + text.size() / sizeof(uint32_t) + 1, 0);
+  std::memcpy(words.data() + first, text.data(), text.size());
+}
+
+// Hand written vertex shader with a uniform block of float4 members, for the patterns slang doesn't emit on its own.
+std::vector<uint32_t> buildBlockModule(const BlockModuleParts &parts) {
+  std::vector<uint32_t> words = {spv::MagicNumber, 0x00010500, 0, BlockIds::Bound, 0};
+  SpirvModule::Emit(words, spv::OpCapability, {spv::CapabilityShader});
+  SpirvModule::Emit(words, spv::OpMemoryModel, {spv::AddressingModelLogical, spv::MemoryModelGLSL450});
+  std::vector<uint32_t> operands = {spv::ExecutionModelVertex, BlockIds::Main};
+  appendString(operands, "main");
+  operands.insert(operands.end(), {BlockIds::Position, BlockIds::Globals});
+  SpirvModule::Emit(words, spv::OpEntryPoint, operands);
+  words.insert(words.end(), parts.Debug.begin(), parts.Debug.end());
+
+  SpirvModule::EmitName(words, BlockIds::Main, "main");
+  SpirvModule::EmitName(words, BlockIds::Block, "GlobalParams");
+  for (uint32_t i = 0; i < std::size(blockMemberNames); i++) {
+    operands = {BlockIds::Block, i};
+    appendString(operands, blockMemberNames[i]);
+    SpirvModule::Emit(words, spv::OpMemberName, operands);
+  }
+  SpirvModule::EmitName(words, BlockIds::Globals, "globalParams");
+
+  SpirvModule::Emit(words, spv::OpDecorate, {BlockIds::Block, spv::DecorationBlock});
+  for (uint32_t i = 0; i < std::size(blockMemberNames); i++) {
+    SpirvModule::Emit(words, spv::OpMemberDecorate, {BlockIds::Block, i, spv::DecorationOffset, i * 16});
+  }
+  SpirvModule::Emit(words, spv::OpDecorate, {BlockIds::Globals, spv::DecorationDescriptorSet, 0});
+  SpirvModule::Emit(words, spv::OpDecorate, {BlockIds::Globals, spv::DecorationBinding, 0});
+  SpirvModule::Emit(words, spv::OpDecorate, {BlockIds::Position, spv::DecorationBuiltIn, spv::BuiltInPosition});
+
+  SpirvModule::Emit(words, spv::OpTypeVoid, {BlockIds::Void});
+  SpirvModule::Emit(words, spv::OpTypeFunction, {BlockIds::MainType, BlockIds::Void});
+  SpirvModule::Emit(words, spv::OpTypeFloat, {BlockIds::Float, 32});
+  SpirvModule::Emit(words, spv::OpTypeVector, {BlockIds::Vec4, BlockIds::Float, 4});
+  SpirvModule::Emit(words, spv::OpTypeInt, {BlockIds::Int, 32, 1});
+  operands = {BlockIds::Block};
+  for (uint32_t i = 0; i < std::size(blockMemberNames); i++) {
+    SpirvModule::Emit(words, spv::OpConstant, {BlockIds::Int, BlockIds::MemberIndex + i, i});
+    operands.push_back(BlockIds::Vec4);
+  }
+  SpirvModule::Emit(words, spv::OpTypeStruct, operands);
+  SpirvModule::Emit(words, spv::OpTypePointer, {BlockIds::BlockPointer, spv::StorageClassUniform, BlockIds::Block});
+  SpirvModule::Emit(words, spv::OpTypePointer, {BlockIds::Vec4Pointer, spv::StorageClassUniform, BlockIds::Vec4});
+  SpirvModule::Emit(words, spv::OpTypePointer, {BlockIds::OutputPointer, spv::StorageClassOutput, BlockIds::Vec4});
+  SpirvModule::Emit(words, spv::OpVariable, {BlockIds::BlockPointer, BlockIds::Globals, spv::StorageClassUniform});
+  SpirvModule::Emit(words, spv::OpVariable, {BlockIds::OutputPointer, BlockIds::Position, spv::StorageClassOutput});
+  words.insert(words.end(), parts.Globals.begin(), parts.Globals.end());
+
+  SpirvModule::Emit(words, spv::OpFunction, {BlockIds::Void, BlockIds::Main, spv::FunctionControlMaskNone, BlockIds::MainType});
+  SpirvModule::Emit(words, spv::OpLabel, {BlockIds::Label});
+  words.insert(words.end(), parts.Body.begin(), parts.Body.end());
+  SpirvModule::Emit(words, spv::OpReturn, {});
+  SpirvModule::Emit(words, spv::OpFunctionEnd, {});
+  words.insert(words.end(), parts.Functions.begin(), parts.Functions.end());
+  return words;
+}
+
+// Reads the member of the uniform block through an access chain, the pointer takes the id before the value.
+void loadBlockMember(std::vector<uint32_t> &body, uint32_t member, uint32_t valueId) {
+  SpirvModule::Emit(body, spv::OpAccessChain, {BlockIds::Vec4Pointer, valueId - 1, BlockIds::Globals, BlockIds::MemberIndex + member});
+  SpirvModule::Emit(body, spv::OpLoad, {BlockIds::Vec4, valueId, valueId - 1});
+}
+
+// Block module storing u_color + u_scale, it has only the patterns the passes handle.
+std::vector<uint32_t> buildMemberReadsModule() {
+  constexpr uint32_t color = BlockIds::FirstFree + 1;
+  constexpr uint32_t scale = BlockIds::FirstFree + 3;
+  constexpr uint32_t sum = BlockIds::FirstFree + 4;
+  BlockModuleParts parts;
+  loadBlockMember(parts.Body, 0, color);
+  loadBlockMember(parts.Body, 2, scale);
+  SpirvModule::Emit(parts.Body, spv::OpFAdd, {BlockIds::Vec4, sum, color, scale});
+  SpirvModule::Emit(parts.Body, spv::OpStore, {BlockIds::Position, sum});
+  return buildBlockModule(parts);
+}
+
+// Block module reading the whole uniform block with one load.
+std::vector<uint32_t> buildWholeBlockLoadModule() {
+  constexpr uint32_t block = BlockIds::FirstFree;
+  constexpr uint32_t color = BlockIds::FirstFree + 1;
+  BlockModuleParts parts;
+  SpirvModule::Emit(parts.Body, spv::OpLoad, {BlockIds::Block, block, BlockIds::Globals});
+  SpirvModule::Emit(parts.Body, spv::OpCompositeExtract, {BlockIds::Vec4, color, block, 0});
+  SpirvModule::Emit(parts.Body, spv::OpStore, {BlockIds::Position, color});
+  return buildBlockModule(parts);
+}
+
+// SPIR-V of the first entry point, compiled with the session settings the compiler uses for the OpenGL targets
+std::vector<uint32_t> compileSpirv(TestContext &context, const char *source) {
+  Slang::ComPtr<slang::IGlobalSession> globalSession;
+  SlangGlobalSessionDesc globalSessionDesc;
+  slang::createGlobalSession(&globalSessionDesc, globalSession.writeRef());
+
+  const BgfxSlang::TargetSettings target{.Profile = {BgfxSlang::TargetFormat::OpenGL, "glsl_440", "glsl_440"}};
+  auto options = target.GetCompilerOptions(BgfxSlang::StageType::Vertex);
+  slang::TargetDesc targetDesc;
+  targetDesc.format = target.Profile.GetSlangTarget();
+  targetDesc.profile = globalSession->findProfile(target.Profile.GetProfile().data());
+  targetDesc.compilerOptionEntryCount = options.size();
+  targetDesc.compilerOptionEntries = options.data();
+
+  slang::SessionDesc sessionDesc{};
+  sessionDesc.defaultMatrixLayoutMode = SLANG_MATRIX_LAYOUT_COLUMN_MAJOR;
+  sessionDesc.targetCount = 1;
+  sessionDesc.targets = &targetDesc;
+
+  Slang::ComPtr<slang::ISession> session;
+  globalSession->createSession(sessionDesc, session.writeRef());
+
+  Slang::ComPtr<slang::IBlob> diagnostics;
+  slang::IModule *module = session->loadModuleFromSourceString("fixture", "fixture.slang", source, diagnostics.writeRef());
+  if (module == nullptr) {
+    context.Check(false, "Failed to load the fixture");
+    return {};
+  }
+
+  Slang::ComPtr<slang::IEntryPoint> entryPoint;
+  module->getDefinedEntryPoint(0, entryPoint.writeRef());
+  slang::IComponentType *components[] = {module, entryPoint};
+
+  Slang::ComPtr<slang::IComponentType> program;
+  Slang::ComPtr<slang::IComponentType> linkedProgram;
+  Slang::ComPtr<slang::IBlob> code;
+  if (SLANG_FAILED(session->createCompositeComponentType(components, 2, program.writeRef(), diagnostics.writeRef())) ||
+      SLANG_FAILED(program->link(linkedProgram.writeRef(), diagnostics.writeRef())) ||
+      SLANG_FAILED(linkedProgram->getEntryPointCode(0, 0, code.writeRef(), diagnostics.writeRef()))) {
+    context.Check(false, "Failed to compile the fixture");
+    return {};
+  }
+
+  const auto *words = static_cast<const uint32_t *>(code->getBufferPointer());
+  return {words, words + code->getBufferSize() / sizeof(uint32_t)};
+}
+
+// Runs spirv-val on the module when it was found at configure time.
+void validateSpirv([[maybe_unused]] TestContext &context, [[maybe_unused]] std::span<const uint32_t> spirv,
+                   [[maybe_unused]] std::string_view name) {
+#ifdef BGFXSLANG_SPIRV_VAL
+  const auto path = std::filesystem::temp_directory_path() / (std::string(name) + ".spv");
+  {
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(spirv.data()), static_cast<std::streamsize>(spirv.size_bytes()));
+  }
+  const auto command = std::string("\"") + BGFXSLANG_SPIRV_VAL + "\" \"" + path.string() + "\"";
+  context.Check(std::system(command.c_str()) == 0, "spirv-val failed for " + path.string());
+#endif
+}
+
+// GLSL with the SPIRV-Cross options of writeGlslShader
+std::string compileGlsl(std::vector<uint32_t> spirv) {
+  spirv_cross::CompilerGLSL glsl(std::move(spirv));
+  spirv_cross::CompilerGLSL::Options options;
+  options.version = glslVersion;
+  options.emit_uniform_buffer_as_plain_uniforms = true;
+  options.enable_420pack_extension = false;
+  glsl.set_common_options(options);
+  return glsl.compile();
+}
+
+// Offset decorations of the struct members by the member names.
+std::map<std::string, uint32_t> getMemberOffsets(std::span<const uint32_t> spirv) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return {};
+  }
+  std::map<std::pair<uint32_t, uint32_t>, std::string> names;
+  std::map<std::string, uint32_t> offsets;
+  for (const auto &inst : module.GetInstructions()) {
+    if (inst.Opcode == spv::OpMemberName) {
+      names[{inst.GetOperand(0), inst.GetOperand(1)}] = inst.GetString(2);
+    } else if (inst.Opcode == spv::OpMemberDecorate && inst.GetOperand(2) == spv::DecorationOffset) {
+      offsets[names[{inst.GetOperand(0), inst.GetOperand(1)}]] = inst.GetOperand(3);
+    }
+  }
+  return offsets;
+}
+
+size_t countInstructions(std::span<const uint32_t> spirv, spv::Op opcode) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return 0;
+  }
+  return std::ranges::count(module.GetInstructions(), opcode, &BgfxSlang::SpirvInstruction::Opcode);
+}
+
+// Whether the instruction with a result type defining the id is in the module.
+bool hasResult(std::span<const uint32_t> spirv, spv::Op opcode, uint32_t id) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return false;
+  }
+  return std::ranges::any_of(module.GetInstructions(), [&](const auto &inst) { return inst.Opcode == opcode && inst.GetOperand(1) == id; });
+}
+
+bool hasRowMajorMembers(std::span<const uint32_t> spirv) {
+  SpirvModule module;
+  if (!module.Parse(spirv)) {
+    return false;
+  }
+  for (const auto &inst : module.GetInstructions()) {
+    if (inst.Opcode == spv::OpMemberDecorate && inst.GetOperand(2) == spv::DecorationRowMajor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void checkContains(TestContext &context, std::string_view glsl, std::string_view text) {
+  context.Check(glsl.find(text) != std::string_view::npos, "GLSL doesn't contain '" + std::string(text) + "'");
+}
+
+void checkNotContains(TestContext &context, std::string_view glsl, std::string_view text) {
+  context.Check(glsl.find(text) == std::string_view::npos, "GLSL contains '" + std::string(text) + "'");
+}
+
+// The refused modules aren't validated, some of the patterns aren't valid in shaders, the pass must leave them to the GLSL rewriter
+// rather than write a wrong module.
+void checkFlattenRefused(TestContext &context, std::vector<uint32_t> spirv) {
+  SpirvModule module;
+  context.Check(module.Parse(spirv), "Malformed module");
+  const auto original = spirv;
+  context.Check(!BgfxSlang::flattenUniformBuffers(spirv), "Flattened a pattern the pass doesn't handle");
+  context.Check(spirv == original, "Refused module was changed");
+}
+} // namespace
+
+void testFlattenMatrix(TestContext &context) {
+  auto spirv = compileSpirv(context, (std::string(columnMajorMatrices) + matrixMain).c_str());
+  if (spirv.empty()) {
+    return;
+  }
+
+  context.Check(!hasRowMajorMembers(spirv), "row_major matrices are row major in SPIR-V");
+  context.Check(BgfxSlang::flattenUniformBuffers(spirv), "Failed to flatten the uniform buffer");
+  validateSpirv(context, spirv, "flatten-matrix");
+  const auto glsl = compileGlsl(std::move(spirv));
+  checkContains(context, glsl, "uniform mat4 u_modelViewProj;");
+  checkContains(context, glsl, "uniform mat3 u_normalMatrix;");
+}
+
+void testKeepRowMajorMatrix(TestContext &context) {
+  const auto spirv = compileSpirv(context, (std::string(rowMajorMatrices) + matrixMain).c_str());
+  if (spirv.empty()) {
+    return;
+  }
+
+  // the plain uniforms can't keep the row major layout, such buffers are left to the GLSL rewriter
+  context.Check(hasRowMajorMembers(spirv), "column_major matrices are column major in SPIR-V");
+  checkFlattenRefused(context, spirv);
+}
+
+void testFlattenBlockModule(TestContext &context) {
+  auto spirv = buildMemberReadsModule();
+  validateSpirv(context, spirv, "flatten-block-module-input");
+
+  context.Check(BgfxSlang::flattenUniformBuffers(spirv), "Failed to flatten the uniform buffer");
+  validateSpirv(context, spirv, "flatten-block-module");
+  const auto glsl = compileGlsl(std::move(spirv));
+  checkContains(context, glsl, "uniform vec4 u_color;");
+  checkContains(context, glsl, "uniform vec4 u_scale;");
+  checkNotContains(context, glsl, "globalParams");
+}
+
+void testKeepWholeBufferLoad(TestContext &context) {
+  const auto spirv = buildWholeBlockLoadModule();
+  validateSpirv(context, spirv, "keep-whole-buffer-load");
+  checkFlattenRefused(context, spirv);
+}
+
+void testKeepBufferPointerArgument(TestContext &context) {
+  constexpr uint32_t functionType = BlockIds::FirstFree;
+  constexpr uint32_t function = BlockIds::FirstFree + 1;
+  constexpr uint32_t parameter = BlockIds::FirstFree + 2;
+  constexpr uint32_t label = BlockIds::FirstFree + 3;
+  constexpr uint32_t colorPointer = BlockIds::FirstFree + 4;
+  constexpr uint32_t color = BlockIds::FirstFree + 5;
+  constexpr uint32_t result = BlockIds::FirstFree + 6;
+
+  // float4 readColor(GlobalParams *params) { return params->u_color; }
+  BlockModuleParts parts;
+  SpirvModule::Emit(parts.Globals, spv::OpTypeFunction, {functionType, BlockIds::Vec4, BlockIds::BlockPointer});
+  SpirvModule::Emit(parts.Functions, spv::OpFunction, {BlockIds::Vec4, function, spv::FunctionControlMaskNone, functionType});
+  SpirvModule::Emit(parts.Functions, spv::OpFunctionParameter, {BlockIds::BlockPointer, parameter});
+  SpirvModule::Emit(parts.Functions, spv::OpLabel, {label});
+  SpirvModule::Emit(parts.Functions, spv::OpAccessChain, {BlockIds::Vec4Pointer, colorPointer, parameter, BlockIds::MemberIndex});
+  SpirvModule::Emit(parts.Functions, spv::OpLoad, {BlockIds::Vec4, color, colorPointer});
+  SpirvModule::Emit(parts.Functions, spv::OpReturnValue, {color});
+  SpirvModule::Emit(parts.Functions, spv::OpFunctionEnd, {});
+
+  SpirvModule::Emit(parts.Body, spv::OpFunctionCall, {BlockIds::Vec4, result, function, BlockIds::Globals});
+  SpirvModule::Emit(parts.Body, spv::OpStore, {BlockIds::Position, result});
+  checkFlattenRefused(context, buildBlockModule(parts));
+}
+
+void testKeepDynamicMemberIndex(TestContext &context) {
+  constexpr uint32_t indexPointer = BlockIds::FirstFree;
+  constexpr uint32_t indexVariable = BlockIds::FirstFree + 1;
+  constexpr uint32_t index = BlockIds::FirstFree + 2;
+  constexpr uint32_t memberPointer = BlockIds::FirstFree + 3;
+  constexpr uint32_t member = BlockIds::FirstFree + 4;
+
+  BlockModuleParts parts;
+  SpirvModule::Emit(parts.Globals, spv::OpTypePointer, {indexPointer, spv::StorageClassInput, BlockIds::Int});
+  SpirvModule::Emit(parts.Globals, spv::OpVariable, {indexPointer, indexVariable, spv::StorageClassInput});
+  SpirvModule::Emit(parts.Body, spv::OpLoad, {BlockIds::Int, index, indexVariable});
+  SpirvModule::Emit(parts.Body, spv::OpAccessChain, {BlockIds::Vec4Pointer, memberPointer, BlockIds::Globals, index});
+  SpirvModule::Emit(parts.Body, spv::OpLoad, {BlockIds::Vec4, member, memberPointer});
+  SpirvModule::Emit(parts.Body, spv::OpStore, {BlockIds::Position, member});
+  checkFlattenRefused(context, buildBlockModule(parts));
+}
+
+void testFlattenArrayWrapper(TestContext &context) {
+  auto spirv = compileSpirv(context, arrayWrapperSource);
+  if (spirv.empty()) {
+    return;
+  }
+
+  context.Check(BgfxSlang::flattenUniformBuffers(spirv), "Failed to flatten the uniform buffer");
+  validateSpirv(context, spirv, "flatten-array-wrapper");
+  const auto glsl = compileGlsl(std::move(spirv));
+  checkContains(context, glsl, "uniform vec4 u_lights[4];");
+  checkContains(context, glsl, "uniform vec4 u_color;");
+  checkNotContains(context, glsl, ".data[");
+}
+
+void testFlattenPacked(TestContext &context) {
+  auto spirv = compileSpirv(context, packedSource);
+  if (spirv.empty()) {
+    return;
+  }
+
+  const std::vector<BgfxSlang::UniformToPack> uniforms = {{"u_time", 1}, {"u_offset", 2}, {"u_direction", 3}};
+  const auto packing = BgfxSlang::packUniforms("u_packed", uniforms);
+  context.Check(BgfxSlang::flattenUniformBuffers(spirv, &packing), "Failed to flatten the uniform buffer");
+  validateSpirv(context, spirv, "flatten-packed");
+  const auto glsl = compileGlsl(std::move(spirv));
+  checkContains(context, glsl, "uniform vec4 u_packed[" + std::to_string(packing.RegisterCount) + "];");
+  checkContains(context, glsl, "uniform vec4 u_color;");
+  for (const auto &uniform : uniforms) {
+    checkNotContains(context, glsl, uniform.Name);
+  }
+}
+
+void testRemoveUnusedOutputs(TestContext &context) {
+  auto spirv = compileSpirv(context, outputsSource);
+  if (spirv.empty()) {
+    return;
+  }
+  checkContains(context, compileGlsl(spirv), "v_unusedUv");
+
+  context.Check(BgfxSlang::removeUnusedOutputs(spirv, {"v_color"}), "Failed to remove the unused outputs");
+  validateSpirv(context, spirv, "remove-unused-outputs");
+  const auto glsl = compileGlsl(std::move(spirv));
+  checkContains(context, glsl, "gl_Position");
+  checkContains(context, glsl, "v_color");
+  checkNotContains(context, glsl, "v_unusedUv");
+}
+
+void testKeepModfStore(TestContext &context) {
+  const auto spirv = compileSpirv(context, modfSource);
+  if (spirv.empty()) {
+    return;
+  }
+
+  auto withoutOutputs = spirv;
+  context.Check(BgfxSlang::removeUnusedOutputs(withoutOutputs, {}), "Failed to remove the unused outputs");
+  validateSpirv(context, withoutOutputs, "keep-modf-store-outputs");
+  checkContains(context, compileGlsl(std::move(withoutOutputs)), "modf(");
+
+  auto optimized = spirv;
+  context.Check(BgfxSlang::optimizeSpirv(optimized, false), "Failed to optimize the module");
+  validateSpirv(context, optimized, "keep-modf-store-optimized");
+  checkContains(context, compileGlsl(std::move(optimized)), "modf(");
+}
+
+void testUsedUniformBufferMembers(TestContext &context) {
+  const auto spirv = compileSpirv(context, partlyUsedSource);
+  if (spirv.empty()) {
+    return;
+  }
+
+  const std::vector<std::string> memberNames = {"u_color", "u_unusedTint", "u_offset", "u_unusedScale"};
+  std::vector<std::string> usedNames;
+  context.Check(BgfxSlang::getUsedUniformBufferMembers(spirv, memberNames, usedNames), "Failed to find the used members");
+  context.Check(usedNames == std::vector<std::string>{"u_color", "u_offset"}, "Unexpected used members");
+
+  const std::vector<std::string> blockNames(std::begin(blockMemberNames), std::end(blockMemberNames));
+  usedNames.clear();
+  context.Check(BgfxSlang::getUsedUniformBufferMembers(buildMemberReadsModule(), blockNames, usedNames),
+                "Failed to find the used members of the hand written module");
+  context.Check(usedNames == std::vector<std::string>{"u_color", "u_scale"}, "Unexpected used members of the hand written module");
+
+  // a load of the whole buffer may read any member
+  usedNames.clear();
+  context.Check(!BgfxSlang::getUsedUniformBufferMembers(buildWholeBlockLoadModule(), blockNames, usedNames),
+                "Found the used members of a whole buffer load");
+}
+
+void testUniformBufferOffsets(TestContext &context) {
+  auto spirv = compileSpirv(context, partlyUsedSource);
+  if (spirv.empty()) {
+    return;
+  }
+
+  // the used members first, as the compiler compacts the buffer
+  const std::pair<std::string, uint32_t> memberOffsets[] = {{"u_color", 0}, {"u_offset", 16}, {"u_unusedTint", 32}, {"u_unusedScale", 48}};
+  context.Check(BgfxSlang::setUniformBufferOffsets(spirv, memberOffsets), "Failed to set the member offsets");
+  validateSpirv(context, spirv, "uniform-buffer-offsets");
+
+  const auto offsets = getMemberOffsets(spirv);
+  for (const auto &[name, offset] : memberOffsets) {
+    const auto it = offsets.find(name);
+    context.Check(it != offsets.end() && it->second == offset, "Unexpected offset of " + name);
+  }
+}
+
+void testOptimizeSpirv(TestContext &context) {
+  constexpr uint32_t file = BlockIds::FirstFree;
+  constexpr uint32_t two = BlockIds::FirstFree + 1;
+  constexpr uint32_t unusedConstant = BlockIds::FirstFree + 2;
+  constexpr uint32_t color = BlockIds::FirstFree + 4;
+  constexpr uint32_t scale = BlockIds::FirstFree + 6;
+  constexpr uint32_t dead = BlockIds::FirstFree + 7;
+  constexpr uint32_t deadSquare = BlockIds::FirstFree + 8;
+  constexpr uint32_t sum = BlockIds::FirstFree + 9;
+  constexpr uint32_t result = BlockIds::FirstFree + 10;
+
+  // (u_color + u_scale) * 2, with the line info of the source, a constant nothing reads and computations only they use
+  BlockModuleParts parts;
+  std::vector<uint32_t> operands = {file};
+  appendString(operands, "fixture.slang");
+  SpirvModule::Emit(parts.Debug, spv::OpString, operands);
+  SpirvModule::Emit(parts.Debug, spv::OpSource, {spv::SourceLanguageHLSL, 500, file});
+  SpirvModule::Emit(parts.Globals, spv::OpConstant, {BlockIds::Float, two, std::bit_cast<uint32_t>(2.0F)});
+  SpirvModule::Emit(parts.Globals, spv::OpConstant, {BlockIds::Float, unusedConstant, std::bit_cast<uint32_t>(0.5F)});
+  SpirvModule::Emit(parts.Body, spv::OpLine, {file, 4, 3});
+  loadBlockMember(parts.Body, 0, color);
+  loadBlockMember(parts.Body, 2, scale);
+  SpirvModule::Emit(parts.Body, spv::OpFMul, {BlockIds::Vec4, dead, color, scale});
+  SpirvModule::Emit(parts.Body, spv::OpFMul, {BlockIds::Vec4, deadSquare, dead, dead});
+  SpirvModule::Emit(parts.Body, spv::OpFAdd, {BlockIds::Vec4, sum, color, scale});
+  SpirvModule::Emit(parts.Body, spv::OpVectorTimesScalar, {BlockIds::Vec4, result, sum, two});
+  SpirvModule::Emit(parts.Body, spv::OpStore, {BlockIds::Position, result});
+  const auto spirv = buildBlockModule(parts);
+  validateSpirv(context, spirv, "optimize-spirv-input");
+
+  auto optimized = spirv;
+  context.Check(BgfxSlang::optimizeSpirv(optimized, false), "Failed to optimize the module");
+  validateSpirv(context, optimized, "optimize-spirv");
+  context.Check(!hasResult(optimized, spv::OpFMul, dead) && !hasResult(optimized, spv::OpFMul, deadSquare),
+                "Unused computations were kept");
+  context.Check(!hasResult(optimized, spv::OpConstant, unusedConstant), "Unused constant was kept");
+  context.Check(hasResult(optimized, spv::OpFAdd, sum) && hasResult(optimized, spv::OpConstant, two), "Used results were removed");
+  for (const auto opcode : {spv::OpString, spv::OpSource, spv::OpLine}) {
+    context.Check(countInstructions(optimized, opcode) == 0, "Debug instruction was kept: " + std::to_string(opcode));
+  }
+  context.Check(countInstructions(optimized, spv::OpName) == countInstructions(spirv, spv::OpName) &&
+                    countInstructions(optimized, spv::OpMemberName) == std::size(blockMemberNames),
+                "Names were removed");
+
+  auto stripped = spirv;
+  context.Check(BgfxSlang::optimizeSpirv(stripped, true), "Failed to optimize the module without names");
+  validateSpirv(context, stripped, "optimize-spirv-stripped");
+  context.Check(countInstructions(stripped, spv::OpName) == 0 && countInstructions(stripped, spv::OpMemberName) == 0,
+                "Names were kept");
+}
+
+} // namespace BgfxSlangTests
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <iostream>
+#include <string_view>
+
+namespace BgfxSlangTests {
+
+// Failed checks are reported on stderr, the test fails when any of its checks failed.
+class TestContext {
+public:
+  explicit TestContext(std::string_view name) : name(name) {}
+
+  void Check(bool condition, std::string_view message) {
+    if (!condition) {
+      std::cerr << name << ": " << message << "\n";
+      failed = true;
+    }
+  }
+
+  [[nodiscard]] bool HasFailed() const { return failed; }
+
+private:
+  std::string_view name;
+  bool failed = false;
+};
+
+void testFlattenMatrix(TestContext &context);
+void testKeepRowMajorMatrix(TestContext &context);
+void testFlattenArrayWrapper(TestContext &context);
+void testFlattenPacked(TestContext &context);
+void testRemoveUnusedOutputs(TestContext &context);
+void testKeepModfStore(TestContext &context);
+void testFlattenBlockModule(TestContext &context);
+void testKeepWholeBufferLoad(TestContext &context);
+void testKeepBufferPointerArgument(TestContext &context);
+void testKeepDynamicMemberIndex(TestContext &context);
+void testRewriteUniformBuffers(TestContext &context);
+void testUsedUniformBufferMembers(TestContext &context);
+void testUniformBufferOffsets(TestContext &context);
+void testOptimizeSpirv(TestContext &context);
+
+} // namespace BgfxSlangTests
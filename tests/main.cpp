@@ -0,0 +1,52 @@
+#include "Tests.h"
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+struct Test {
+  std::string_view Name;
+  std::function<void(BgfxSlangTests::TestContext &)> Run;
+};
+
+// Usage: bgfx-slang-tests [test...]. Runs all tests when none is given, returns 1 when any of them failed.
+int main(int argc, char **argv) {
+  const Test tests[] = {
+      {"flatten-matrix", BgfxSlangTests::testFlattenMatrix},
+      {"keep-row-major-matrix", BgfxSlangTests::testKeepRowMajorMatrix},
+      {"flatten-array-wrapper", BgfxSlangTests::testFlattenArrayWrapper},
+      {"flatten-packed", BgfxSlangTests::testFlattenPacked},
+      {"remove-unused-outputs", BgfxSlangTests::testRemoveUnusedOutputs},
+      {"keep-modf-store", BgfxSlangTests::testKeepModfStore},
+      {"flatten-block-module", BgfxSlangTests::testFlattenBlockModule},
+      {"keep-whole-buffer-load", BgfxSlangTests::testKeepWholeBufferLoad},
+      {"keep-buffer-pointer-argument", BgfxSlangTests::testKeepBufferPointerArgument},
+      {"keep-dynamic-member-index", BgfxSlangTests::testKeepDynamicMemberIndex},
+      {"rewrite-uniform-buffers", BgfxSlangTests::testRewriteUniformBuffers},
+      {"used-uniform-buffer-members", BgfxSlangTests::testUsedUniformBufferMembers},
+      {"uniform-buffer-offsets", BgfxSlangTests::testUniformBufferOffsets},
+      {"optimize-spirv", BgfxSlangTests::testOptimizeSpirv},
+  };
+
+  bool failed = false;
+  for (const auto &test : tests) {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc; i++) {
+      selected |= test.Name == argv[i];
+    }
+    if (!selected) {
+      continue;
+    }
+
+    BgfxSlangTests::TestContext context(test.Name);
+    // SPIRV-Cross throws on modules it can't compile
+    try {
+      test.Run(context);
+    } catch (const std::exception &exception) {
+      context.Check(false, exception.what());
+    }
+    std::cout << (context.HasFailed() ? "FAIL " : "PASS ") << test.Name << "\n";
+    failed |= context.HasFailed();
+  }
+  return failed ? 1 : 0;
+}
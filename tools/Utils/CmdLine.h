@@ -5,21 +5,76 @@
 
 namespace BgfxSlangCmd {
 
-enum class TokenType { Input, Output, Target, Verbose, Bin2C, Include, StageType };
+enum class TokenType {
+  Input,
+  Output,
+  Target,
+  Verbose,
+  Bin2C,
+  Bin2CFormat,
+  Include,
+  StageType,
+  Permutation,
+  Jobs,
+  Cache,
+  CacheDir,
+  NoModuleCache,
+  Depfile,
+  Pack,
+  PackTag,
+  PackCompression,
+  PackCompressionLevel,
+  Bindings,
+  Link,
+  PackedUniforms,
+  PackedUniformsHeader,
+  CompactUniforms,
+  Optimization,
+  OptimizeSpirv,
+  Trace,
+  Watch,
+  Serve,
+  Connect,
+};
 struct Token {
   TokenType Type;
   std::string_view Short;
   std::string_view Long;
+  bool IsFlag = false;
+  // the value can follow the short name in the same argument (-O3)
+  bool HasAttachedValue = false;
 };
 
 constexpr std::array tokens = {
     Token{TokenType::Input, "", ""},
     Token{TokenType::Output, "-o", "--output"},
     Token{TokenType::Target, "-t", "--target"},
-    Token{TokenType::Verbose, "-v", "--verbose"},
+    Token{TokenType::Verbose, "-v", "--verbose", true},
     Token{TokenType::Bin2C, "-b", "--bin2c"},
+    Token{TokenType::Bin2CFormat, "", "--bin2c-format"},
     Token{TokenType::Include, "-i", "--include"},
     Token{TokenType::StageType, "-s", "--stage"},
+    Token{TokenType::Permutation, "-p", "--permutation"},
+    Token{TokenType::Jobs, "-j", "--jobs"},
+    Token{TokenType::Cache, "-c", "--cache", true},
+    Token{TokenType::CacheDir, "", "--cache-dir"},
+    Token{TokenType::NoModuleCache, "", "--no-module-cache", true},
+    Token{TokenType::Depfile, "", "--depfile"},
+    Token{TokenType::Pack, "", "--pack"},
+    Token{TokenType::PackTag, "", "--pack-tag"},
+    Token{TokenType::PackCompression, "", "--pack-compression"},
+    Token{TokenType::PackCompressionLevel, "", "--pack-compression-level"},
+    Token{TokenType::Bindings, "", "--bindings"},
+    Token{TokenType::Link, "", "--link"},
+    Token{TokenType::PackedUniforms, "", "--packed-uniforms"},
+    Token{TokenType::PackedUniformsHeader, "", "--packed-uniforms-header"},
+    Token{TokenType::CompactUniforms, "", "--compact-uniforms", true},
+    Token{TokenType::Optimization, "-O", "--optimization", false, true},
+    Token{TokenType::OptimizeSpirv, "", "--optimize-spirv", true},
+    Token{TokenType::Trace, "", "--trace"},
+    Token{TokenType::Watch, "-w", "--watch", true},
+    Token{TokenType::Serve, "", "--serve"},
+    Token{TokenType::Connect, "", "--connect"},
 };
 
 struct TokenValues {
@@ -62,13 +117,24 @@ private:
 
       bool tokenFound = false;
       for (const auto &token : tokens) {
+        if (token.HasAttachedValue && !token.Short.empty() && arg.size() > token.Short.size() && arg.starts_with(token.Short)) {
+          tokenFound = true;
+          auto *value = const_cast<TokenValues *>(find(token.Type));
+          if (value == nullptr) {
+            value = &values.emplace_back(token.Type);
+          }
+          value->Values.push_back(arg.substr(token.Short.size()));
+          currentToken = TokenType::Input;
+          break;
+        }
         if (arg == token.Short || arg == token.Long) {
           tokenFound = true;
-          currentToken = token.Type;
-          auto *value = const_cast<TokenValues *>(find(currentToken));
+          auto *value = const_cast<TokenValues *>(find(token.Type));
           if (value == nullptr) {
-            values.emplace_back(currentToken);
+            values.emplace_back(token.Type);
           }
+          // flags don't take values, following argument is an input again
+          currentToken = token.IsFlag ? TokenType::Input : token.Type;
           break;
         }
       }
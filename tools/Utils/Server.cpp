@@ -0,0 +1,227 @@
+#include "Server.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace BgfxSlangCmd {
+
+#ifndef _WIN32
+
+namespace {
+constexpr uint32_t protocolVersion = 1;
+constexpr uint32_t maxArgCount = 4096;
+constexpr uint32_t maxStringSize = 64 * 1024 * 1024;
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void onStopSignal(int /*signal*/) { stopRequested = 1; }
+
+class Socket {
+public:
+  explicit Socket(int fd = -1) : fd(fd) {}
+  ~Socket() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  Socket(const Socket &) = delete;
+  Socket &operator=(const Socket &) = delete;
+
+  [[nodiscard]] int Get() const { return fd; }
+  [[nodiscard]] bool IsValid() const { return fd >= 0; }
+
+private:
+  int fd;
+};
+
+bool makeAddress(std::string_view socketPath, sockaddr_un &address) {
+  address = {};
+  address.sun_family = AF_UNIX;
+  if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  socketPath.copy(address.sun_path, socketPath.size());
+  return true;
+}
+
+bool writeAll(int fd, const void *data, size_t size) {
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    auto written = write(fd, bytes, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool readAll(int fd, void *data, size_t size) {
+  auto *bytes = static_cast<uint8_t *>(data);
+  while (size > 0) {
+    auto bytesRead = read(fd, bytes, size);
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytesRead <= 0) {
+      return false;
+    }
+    bytes += bytesRead;
+    size -= bytesRead;
+  }
+  return true;
+}
+
+bool writeU32(int fd, uint32_t value) { return writeAll(fd, &value, sizeof(value)); }
+bool readU32(int fd, uint32_t &value) { return readAll(fd, &value, sizeof(value)); }
+
+bool writeString(int fd, std::string_view str) {
+  return writeU32(fd, static_cast<uint32_t>(str.size())) && writeAll(fd, str.data(), str.size());
+}
+
+bool readString(int fd, std::string &str) {
+  uint32_t size = 0;
+  if (!readU32(fd, size) || size > maxStringSize) {
+    return false;
+  }
+  str.resize(size);
+  return readAll(fd, str.data(), size);
+}
+
+bool readRequest(int fd, ServerRequest &request) {
+  uint32_t version = 0;
+  uint32_t argCount = 0;
+  if (!readU32(fd, version) || version != protocolVersion || !readString(fd, request.WorkingDirectory) || !readU32(fd, argCount) ||
+      argCount > maxArgCount) {
+    return false;
+  }
+
+  request.Args.resize(argCount);
+  for (auto &arg : request.Args) {
+    if (!readString(fd, arg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Removes socket file left by a server that was not shut down cleanly. Returns false when other server is still listening.
+bool removeStaleSocket(const sockaddr_un &address) {
+  Socket probe{socket(AF_UNIX, SOCK_STREAM, 0)};
+  if (probe.IsValid() && connect(probe.Get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0) {
+    return false;
+  }
+  unlink(address.sun_path);
+  return true;
+}
+} // namespace
+
+bool serve(std::string_view socketPath, const ServerRequestHandler &handler, std::ostream &log) {
+  sockaddr_un address;
+  if (!makeAddress(socketPath, address)) {
+    log << "Invalid socket path: " << socketPath << '\n';
+    return false;
+  }
+  if (!removeStaleSocket(address)) {
+    log << "Server is already listening on: " << socketPath << '\n';
+    return false;
+  }
+
+  Socket server{socket(AF_UNIX, SOCK_STREAM, 0)};
+  if (!server.IsValid() || bind(server.Get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+      listen(server.Get(), SOMAXCONN) != 0) {
+    log << "Failed to listen on: " << socketPath << " (" << std::strerror(errno) << ")\n";
+    return false;
+  }
+
+  // no SA_RESTART, so accept is interrupted and the loop can finish
+  struct sigaction action = {};
+  action.sa_handler = onStopSignal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  log << "Listening on: " << socketPath << '\n';
+  log.flush();
+
+  while (stopRequested == 0) {
+    Socket client{accept(server.Get(), nullptr, nullptr)};
+    if (!client.IsValid()) {
+      if (errno != EINTR) {
+        log << "Failed to accept connection (" << std::strerror(errno) << ")\n";
+      }
+      continue;
+    }
+
+    ServerRequest request;
+    if (!readRequest(client.Get(), request)) {
+      log << "Invalid request\n";
+      continue;
+    }
+
+    const auto response = handler(request);
+    if (!writeU32(client.Get(), static_cast<uint32_t>(response.ExitCode)) || !writeString(client.Get(), response.Output)) {
+      log << "Failed to send response\n";
+    }
+  }
+
+  unlink(address.sun_path);
+  log << "Server stopped\n";
+  return true;
+}
+
+bool sendRequest(std::string_view socketPath, const ServerRequest &request, ServerResponse &response) {
+  sockaddr_un address;
+  if (!makeAddress(socketPath, address)) {
+    return false;
+  }
+
+  Socket client{socket(AF_UNIX, SOCK_STREAM, 0)};
+  if (!client.IsValid() || connect(client.Get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+    return false;
+  }
+  std::signal(SIGPIPE, SIG_IGN);
+
+  bool sent = writeU32(client.Get(), protocolVersion) && writeString(client.Get(), request.WorkingDirectory) &&
+              writeU32(client.Get(), static_cast<uint32_t>(request.Args.size()));
+  for (size_t i = 0; sent && i < request.Args.size(); i++) {
+    sent = writeString(client.Get(), request.Args[i]);
+  }
+
+  uint32_t exitCode = 0;
+  if (!sent || !readU32(client.Get(), exitCode) || !readString(client.Get(), response.Output)) {
+    return false;
+  }
+  response.ExitCode = static_cast<int>(exitCode);
+  return true;
+}
+
+#else
+
+bool serve(std::string_view /*socketPath*/, const ServerRequestHandler & /*handler*/, std::ostream &log) {
+  log << "Server mode is not supported on this platform\n";
+  return false;
+}
+
+bool sendRequest(std::string_view /*socketPath*/, const ServerRequest & /*request*/, ServerResponse & /*response*/) { return false; }
+
+#endif
+
+} // namespace BgfxSlangCmd
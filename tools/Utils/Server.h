@@ -0,0 +1,31 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BgfxSlangCmd {
+
+// Command line forwarded by the client, relative paths are resolved against WorkingDirectory.
+struct ServerRequest {
+  std::string WorkingDirectory;
+  std::vector<std::string> Args;
+};
+
+struct ServerResponse {
+  int ExitCode = 1;
+  std::string Output;
+};
+
+using ServerRequestHandler = std::function<ServerResponse(const ServerRequest &)>;
+
+// Listens on the Unix domain socket and handles requests one at a time until SIGINT or SIGTERM. Returns false when the socket
+// can't be created.
+bool serve(std::string_view socketPath, const ServerRequestHandler &handler, std::ostream &log);
+
+// Forwards the request to the server. Returns false when the server is not available.
+bool sendRequest(std::string_view socketPath, const ServerRequest &request, ServerResponse &response);
+
+} // namespace BgfxSlangCmd
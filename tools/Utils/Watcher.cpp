@@ -0,0 +1,171 @@
+#include "Watcher.h"
+#include <filesystem>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+#endif
+
+namespace BgfxSlangCmd {
+
+#ifdef __linux__
+
+namespace {
+// events arriving this soon after the previous one are handled together, editors often write the file more than once on save
+constexpr int settleTimeoutMs = 50;
+constexpr uint32_t eventMask = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void onStopSignal(int /*signal*/) { stopRequested = 1; }
+
+class Inotify {
+public:
+  Inotify() : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+  ~Inotify() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  Inotify(const Inotify &) = delete;
+  Inotify &operator=(const Inotify &) = delete;
+
+  [[nodiscard]] int Get() const { return fd; }
+  [[nodiscard]] bool IsValid() const { return fd >= 0; }
+
+  // Watches the directories of the paths, the directories not needed anymore are removed. Returns false when nothing is watched.
+  bool SetPaths(const std::vector<std::string> &paths, std::ostream &log) {
+    files.clear();
+    std::set<std::string> neededDirectories;
+    for (const auto &path : paths) {
+      const auto normalized = std::filesystem::absolute(path).lexically_normal();
+      files.insert(normalized.string());
+      neededDirectories.insert(normalized.parent_path().string());
+    }
+
+    for (auto it = directories.begin(); it != directories.end();) {
+      if (neededDirectories.contains(it->second)) {
+        ++it;
+        continue;
+      }
+      inotify_rm_watch(fd, it->first);
+      it = directories.erase(it);
+    }
+
+    // adding already watched directory returns its existing descriptor
+    for (const auto &directory : neededDirectories) {
+      const int wd = inotify_add_watch(fd, directory.c_str(), eventMask);
+      if (wd < 0) {
+        log << "Failed to watch directory: " << directory << " (" << std::strerror(errno) << ")\n";
+        continue;
+      }
+      directories[wd] = directory;
+    }
+    return !directories.empty();
+  }
+
+  // Adds the watched files of the pending events to changedPaths. Returns false when the events can't be read.
+  bool Read(std::set<std::string> &changedPaths) {
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+      const auto size = read(fd, buffer, sizeof(buffer));
+      if (size < 0) {
+        return errno == EAGAIN || errno == EINTR;
+      }
+
+      for (ssize_t offset = 0; offset < size;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        const auto directory = directories.find(event->wd);
+        if (directory == directories.end() || event->len == 0) {
+          continue;
+        }
+        auto path = (std::filesystem::path{directory->second} / event->name).string();
+        if (files.contains(path)) {
+          changedPaths.insert(std::move(path));
+        }
+      }
+    }
+  }
+
+private:
+  int fd;
+  std::unordered_map<int, std::string> directories;
+  std::set<std::string> files;
+};
+
+// Returns true when events arrived within the timeout, -1 waits until an event or a signal.
+bool waitForEvents(const Inotify &inotify, int timeoutMs) {
+  pollfd descriptor = {inotify.Get(), POLLIN, 0};
+  return poll(&descriptor, 1, timeoutMs) > 0;
+}
+} // namespace
+
+bool watch(const std::vector<std::string> &paths, const WatchHandler &handler, std::ostream &log) {
+  Inotify inotify;
+  if (!inotify.IsValid()) {
+    log << "Failed to initialize inotify (" << std::strerror(errno) << ")\n";
+    return false;
+  }
+  if (!inotify.SetPaths(paths, log)) {
+    return false;
+  }
+
+  // no SA_RESTART, so poll is interrupted and the loop can finish
+  struct sigaction action = {};
+  action.sa_handler = onStopSignal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  log << "Watching " << paths.size() << " files for changes\n";
+  log.flush();
+
+  while (stopRequested == 0) {
+    if (!waitForEvents(inotify, -1)) {
+      continue;
+    }
+
+    std::set<std::string> changedPaths;
+    do {
+      if (!inotify.Read(changedPaths)) {
+        log << "Failed to read file events (" << std::strerror(errno) << ")\n";
+        return false;
+      }
+    } while (stopRequested == 0 && waitForEvents(inotify, settleTimeoutMs));
+
+    if (stopRequested != 0 || changedPaths.empty()) {
+      continue;
+    }
+    // nothing is watched anymore when none of the directories of the rebuilt program can be watched
+    if (!inotify.SetPaths(handler({changedPaths.begin(), changedPaths.end()}), log)) {
+      log << "No files left to watch\n";
+      return false;
+    }
+    log.flush();
+  }
+
+  log << "Watch stopped\n";
+  return true;
+}
+
+#else
+
+bool watch(const std::vector<std::string> & /*paths*/, const WatchHandler & /*handler*/, std::ostream &log) {
+  log << "Watch mode is not supported on this platform\n";
+  return false;
+}
+
+#endif
+
+} // namespace BgfxSlangCmd
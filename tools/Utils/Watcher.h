@@ -0,0 +1,19 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace BgfxSlangCmd {
+
+// Receives the changed files (absolute, lexically normal paths) and returns the files to watch next, as the edit may have added or
+// removed imports.
+using WatchHandler = std::function<std::vector<std::string>(const std::vector<std::string> &changedPaths)>;
+
+// Watches the files with inotify and calls the handler when some of them were written, until SIGINT or SIGTERM. The directories are
+// watched instead of the files, so the editors replacing the file on save are noticed too. Returns false when the files can't be
+// watched.
+bool watch(const std::vector<std::string> &paths, const WatchHandler &handler, std::ostream &log);
+
+} // namespace BgfxSlangCmd
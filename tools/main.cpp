@@ -1,54 +1,256 @@
+#include "BgfxSlang/CompileCache.h"
 #include "BgfxSlang/Compiler.h"
 #include "BgfxSlang/EntryPoint.h"
+#include "BgfxSlang/GlobalSessionPool.h"
+#include "BgfxSlang/ModuleCache.h"
+#include "BgfxSlang/Permutation.h"
+#include "BgfxSlang/ProgramBindingsWriter.h"
+#include "BgfxSlang/ShaderPack.h"
+#include "BgfxSlang/ShaderPackWriter.h"
 #include "BgfxSlang/Status.h"
 #include "BgfxSlang/Target.h"
+#include "BgfxSlang/UniformPacking.h"
 #include "BgfxSlang/Utils/Bin2cWriter.h"
-#include "BgfxSlang/Utils/ConsoleWriter.h"
+#include "BgfxSlang/Utils/ChromeTrace.h"
+#include "BgfxSlang/Utils/IWriter.h"
 #include "BgfxSlang/Utils/FileWriter.h"
+#include "BgfxSlang/Utils/Trace.h"
 #include "Utils/CmdLine.h"
+#include "Utils/Server.h"
 #include "Utils/StringFormat.h"
+#include "Utils/Watcher.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-void verifyStatus(const BgfxSlang::Status &status) {
+std::mutex outputMutex;
+std::mutex packMutex;
+
+bool checkStatus(std::ostream &out, const BgfxSlang::Status &status) {
   if (!status.IsOk()) {
-    std::cout << status.GetMessage() << '\n';
-    if (status.IsError()) {
-      exit(1);
-    }
+    std::lock_guard lock(outputMutex);
+    out << status.GetMessage() << '\n';
   }
+  return !status.IsError();
 }
 
-void validateArgs(const BgfxSlangCmd::CmdLine &cmdLine) {
+bool validateArgs(const BgfxSlangCmd::CmdLine &cmdLine, std::ostream &out) {
   if (!cmdLine.Has(BgfxSlangCmd::TokenType::Input)) {
-    std::cout << "Input file is not specified\n";
-    exit(1);
-  }
-  if (cmdLine.GetCount(BgfxSlangCmd::TokenType::Input) > 1) {
-    std::cout << "Only one input file is allowed\n";
-    exit(1);
+    out << "Input file is not specified\n";
+    return false;
   }
   if (!cmdLine.Has(BgfxSlangCmd::TokenType::Target)) {
-    std::cout << "At least one target needs to be specified\n";
-    exit(1);
+    out << "At least one target needs to be specified\n";
+    return false;
   }
+  return true;
 }
 
-void printLog(bool verbose, std::string_view message) {
+void printLog(std::ostream &out, bool verbose, std::string_view message) {
   if (verbose) {
-    std::cout << message << '\n';
+    std::lock_guard lock(outputMutex);
+    out << message << '\n';
+  }
+}
+
+// Compiler verbose log writer, shares the lock with the tool messages as the output may be a string stream in server mode.
+class LogWriter : public BgfxSlang::IWriter {
+public:
+  explicit LogWriter(std::ostream &out) : out(out) {}
+
+private:
+  std::ostream &out;
+
+  void write(const void *data, size_t size) override {
+    std::lock_guard lock(outputMutex);
+    out << std::string_view{static_cast<const char *>(data), size} << '\n';
+  }
+};
+
+// Outputs written for an input file and the files they were built from.
+struct FileDependencies {
+  std::vector<std::string> Outputs;
+  std::vector<std::string> Inputs;
+};
+
+// Kept between the builds of the watch mode.
+struct WatchState {
+  // absolute, lexically normal paths of the files changed since the previous build, empty for the first build
+  std::vector<std::string> ChangedPaths;
+  // dependencies of the previous builds by input path
+  std::unordered_map<std::string, FileDependencies> Dependencies;
+  // entry point hashes of the written outputs by output path
+  std::mutex OutputHashesMutex;
+  std::unordered_map<std::string, std::string> OutputHashes;
+};
+
+struct Options {
+  std::ostream *Out = &std::cout;
+  std::string_view OutputFormat = "{{target}}/{{name}}_{{stage}}.bin";
+  bool Verbose = false;
+  bool Bin2C = false;
+  std::string_view Bin2CVarFormat = "{{name}}_{{stage}}_{{target}}";
+  BgfxSlang::Bin2cFormat Bin2CFormat = BgfxSlang::Bin2cFormat::Ascii;
+  const std::vector<std::string_view> *Targets = nullptr;
+  const std::vector<std::string_view> *Includes = nullptr;
+  const std::vector<std::string_view> *Stages = nullptr;
+  const BgfxSlang::CompileCache *Cache = nullptr;
+  BgfxSlang::ModuleCache *ModuleCache = nullptr;
+  std::vector<BgfxSlang::Permutation> Permutations;
+  // shaders are added to the pack instead of being written to separate files
+  BgfxSlang::ShaderPackWriter *Pack = nullptr;
+  std::string_view PackTag;
+  // program bindings path template, empty when not written
+  std::string_view BindingsFormat;
+  // user attribute pairing the vertex and fragment entry points compiled as one program, empty when not linked
+  std::string_view LinkTag;
+  // name of the vec4 array uniform with the packed float uniforms, empty when not packed
+  std::string_view PackedUniforms;
+  // packed uniforms header path template, empty when not written
+  std::string_view PackedUniformsHeaderFormat;
+  // SPIR-V shaders get uniform buffers with only the uniforms they read
+  bool CompactUniforms = false;
+  // optimization of every target, by target name
+  std::map<std::string_view, BgfxSlang::TargetOptimization> Optimizations;
+  BgfxSlang::ITraceSink *Trace = nullptr;
+  WatchState *Watch = nullptr;
+};
+
+// Level of -O0 to -O3.
+BgfxSlang::OptimizationLevel getOptimizationLevelFromName(std::string_view name) {
+  if (name == "0") {
+    return BgfxSlang::OptimizationLevel::None;
+  }
+  if (name == "1") {
+    return BgfxSlang::OptimizationLevel::Default;
+  }
+  if (name == "2") {
+    return BgfxSlang::OptimizationLevel::High;
+  }
+  if (name == "3") {
+    return BgfxSlang::OptimizationLevel::Maximal;
+  }
+  return BgfxSlang::OptimizationLevel::Unknown;
+}
+
+// Optimization levels (-O <level> or -O <target>:<level>, the target ones take precedence) and --optimize-spirv of the targets.
+bool parseOptimizations(const BgfxSlangCmd::CmdLine &cmdLine, std::ostream &out, Options &options) {
+  BgfxSlang::TargetOptimization optimization;
+  optimization.OptimizesSpirv = cmdLine.Has(BgfxSlangCmd::TokenType::OptimizeSpirv);
+  std::map<std::string_view, BgfxSlang::OptimizationLevel> targetLevels;
+  if (const auto *levels = cmdLine.Get(BgfxSlangCmd::TokenType::Optimization); levels != nullptr) {
+    for (const auto value : *levels) {
+      const auto separatorPos = value.rfind(':');
+      const auto levelName = separatorPos == std::string_view::npos ? value : value.substr(separatorPos + 1);
+      const auto level = getOptimizationLevelFromName(levelName);
+      if (level == BgfxSlang::OptimizationLevel::Unknown) {
+        out << "Invalid optimization level: " << value << '\n';
+        return false;
+      }
+      if (separatorPos == std::string_view::npos) {
+        optimization.Level = level;
+      } else {
+        targetLevels[value.substr(0, separatorPos)] = level;
+      }
+    }
+  }
+
+  for (const auto target : *options.Targets) {
+    auto &targetOptimization = options.Optimizations[target];
+    targetOptimization = optimization;
+    if (auto it = targetLevels.find(target); it != targetLevels.end()) {
+      targetOptimization.Level = it->second;
+    }
+  }
+  return true;
+}
+
+// Whole argument as a decimal integer, false for other text and out of range values.
+bool parseInt(std::string_view value, int64_t &outValue) {
+  const auto *end = value.data() + value.size();
+  const auto [ptr, error] = std::from_chars(value.data(), end, outValue);
+  return !value.empty() && error == std::errc{} && ptr == end;
+}
+
+// Comma separated list of defines (NAME or NAME=VALUE) and link-time constants (TYPE:NAME=VALUE).
+bool parsePermutation(std::string_view value, BgfxSlang::Permutation &permutation) {
+  while (!value.empty()) {
+    auto end = value.find(',');
+    auto item = value.substr(0, end);
+    value = end == std::string_view::npos ? std::string_view{} : value.substr(end + 1);
+    if (item.empty()) {
+      continue;
+    }
+
+    auto equalsPos = item.find('=');
+    auto typePos = item.find(':');
+    if (typePos != std::string_view::npos && typePos < equalsPos) {
+      if (equalsPos == std::string_view::npos) {
+        return false;
+      }
+      permutation.Constants.push_back({std::string(item.substr(0, typePos)),
+                                       std::string(item.substr(typePos + 1, equalsPos - typePos - 1)),
+                                       std::string(item.substr(equalsPos + 1))});
+    } else if (equalsPos == std::string_view::npos) {
+      permutation.Defines.push_back({std::string(item)});
+    } else {
+      permutation.Defines.push_back({std::string(item.substr(0, equalsPos)), std::string(item.substr(equalsPos + 1))});
+    }
+  }
+  return true;
+}
+
+// inputs starting with @ are response files with one input path per line
+bool getInputPaths(const BgfxSlangCmd::CmdLine &cmdLine, std::ostream &out, std::vector<std::string> &inputPaths) {
+  for (const auto &input : *cmdLine.Get(BgfxSlangCmd::TokenType::Input)) {
+    if (!input.starts_with('@')) {
+      inputPaths.emplace_back(input);
+      continue;
+    }
+
+    std::ifstream file{std::string(input.substr(1))};
+    if (!file.is_open()) {
+      out << "Failed to open response file: " << input.substr(1) << '\n';
+      return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+      auto first = line.find_first_not_of(" \t\r");
+      auto last = line.find_last_not_of(" \t\r");
+      if (first == std::string::npos || line[first] == '#') {
+        continue;
+      }
+      inputPaths.push_back(line.substr(first, last - first + 1));
+    }
   }
+  return true;
 }
 
 std::string formatOutputPath(std::string_view format, const std::filesystem::path &inputPath, const BgfxSlang::TargetProfile &target,
-                             const BgfxSlang::EntryPoint &entryPoint) {
+                             const BgfxSlang::EntryPoint &entryPoint, int64_t permutationIdx) {
 
   return BgfxSlangCmd::formatString(format, {{"{{name}}", inputPath.stem().string()},
+                                             {"{{permutation}}", std::to_string(permutationIdx)},
                                              {"{{filename}}", inputPath.filename().string()},
                                              {"{{entryPoint}}", entryPoint.Name},
                                              {"{{stage}}", BgfxSlang::getStageShortName(entryPoint.Stage)},
@@ -56,90 +258,753 @@ std::string formatOutputPath(std::string_view format, const std::filesystem::pat
 }
 
 std::string formatHeaderVarName(std::string_view format, const std::filesystem::path &inputPath, const BgfxSlang::TargetProfile &target,
-                                const BgfxSlang::EntryPoint &entryPoint) {
+                                const BgfxSlang::EntryPoint &entryPoint, int64_t permutationIdx) {
 
   return BgfxSlangCmd::formatString(format, {{"{{name}}", inputPath.stem().string()},
+                                             {"{{permutation}}", std::to_string(permutationIdx)},
                                              {"{{filename}}", inputPath.filename().string()},
                                              {"{{entryPoint}}", entryPoint.Name},
                                              {"{{stage}}", BgfxSlang::getStageShortName(entryPoint.Stage)},
                                              {"{{target}}", BgfxSlang::GetTargetShortNameForHeaderVar(target)}});
 }
 
-int main(int argc, char **argv) {
-  BgfxSlangCmd::CmdLine cmdLine(argc, argv);
-  validateArgs(cmdLine);
+// Path of the program bindings, written for every input file, target and permutation.
+std::string formatBindingsPath(std::string_view format, const std::filesystem::path &inputPath, const BgfxSlang::TargetProfile &target,
+                               int64_t permutationIdx) {
+  return BgfxSlangCmd::formatString(format, {{"{{name}}", inputPath.stem().string()},
+                                             {"{{permutation}}", std::to_string(permutationIdx)},
+                                             {"{{filename}}", inputPath.filename().string()},
+                                             {"{{target}}", BgfxSlang::GetTargetShortName(target)}});
+}
+
+// Header variable of the program bindings written with bin2c, the file name with the characters invalid in identifiers replaced.
+std::string getBindingsVarName(const std::string &path) {
+  auto name = std::filesystem::path{path}.stem().string();
+  for (auto &c : name) {
+    if (std::isalnum(static_cast<unsigned char>(c)) == 0) {
+      c = '_';
+    }
+  }
+  return name;
+}
+
+bool writeBindings(const std::string &path, const BgfxSlang::ProgramBindingsWriter &bindings, const Options &options) {
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path{path}.parent_path(), error);
+
+  std::unique_ptr<BgfxSlang::FileWriter> writer;
+  if (options.Bin2C) {
+    writer = std::make_unique<BgfxSlang::Bin2cWriter>(getBindingsVarName(path), options.Bin2CFormat);
+  } else {
+    writer = std::make_unique<BgfxSlang::FileWriter>();
+  }
+  writer->Open(path);
+  if (!checkStatus(*options.Out, bindings.Write(*writer))) {
+    writer->Discard();
+    return false;
+  }
+  if (!writer->Close()) {
+    std::lock_guard lock(outputMutex);
+    *options.Out << "Failed to write file: " << path << '\n';
+    return false;
+  }
+  return true;
+}
 
-  std::string_view outputFormat = "{{target}}/{{name}}_{{stage}}.bin";
+// Header with the packed uniform offsets, written for every input file.
+bool writePackedUniformsHeader(const std::string &path, const std::filesystem::path &inputPath, const BgfxSlang::UniformPacking &packing,
+                               const Options &options) {
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path{path}.parent_path(), error);
 
-  if (cmdLine.Has(BgfxSlangCmd::TokenType::Output)) {
-    outputFormat = cmdLine.GetOne(BgfxSlangCmd::TokenType::Output);
+  const auto header = BgfxSlang::formatPackedUniformsHeader(packing, getBindingsVarName(inputPath.string()) + "_uniforms");
+  BgfxSlang::FileWriter writer;
+  writer.Open(path);
+  writer.Write(header.data(), header.size());
+  if (!writer.Close()) {
+    std::lock_guard lock(outputMutex);
+    *options.Out << "Failed to write file: " << path << '\n';
+    return false;
   }
+  return true;
+}
 
-  auto targetCount = cmdLine.GetCount(BgfxSlangCmd::TokenType::Target);
-  auto verbose = cmdLine.Has(BgfxSlangCmd::TokenType::Verbose);
-  auto bin2C = cmdLine.Has(BgfxSlangCmd::TokenType::Bin2C);
+// First argument of the entry point attribute used as the shader pack tag or link tag, for example "CastShadow" of
+// [Pass("CastShadow")].
+std::string getEntryPointTag(const BgfxSlang::EntryPoint &entryPoint, std::string_view attributeName) {
+  for (const auto &attribute : entryPoint.Attributes) {
+    if (attribute.GetName() != attributeName || attribute.GetArgumentCount() == 0) {
+      continue;
+    }
+    switch (attribute.GetArgumentType(0)) {
+    case BgfxSlang::ArgumentType::String:
+      return std::string(attribute.GetArgumentValueString(0));
+    case BgfxSlang::ArgumentType::Int:
+      return std::to_string(attribute.GetArgumentValueInt(0));
+    default:
+      return {};
+    }
+  }
+  return {};
+}
 
-  std::string_view bin2CVarFormat = "{{name}}_{{stage}}_{{target}}";
-  if (cmdLine.Has(BgfxSlangCmd::TokenType::Bin2C)) {
-    bin2CVarFormat = cmdLine.GetOne(BgfxSlangCmd::TokenType::Bin2C, bin2CVarFormat);
+// Links the vertex and fragment entry points tagged with the same attribute argument, for example the ones with [Pass("Opaque")].
+// Tags with only one of the stages are not linked.
+BgfxSlang::Status linkEntryPoints(BgfxSlang::Compiler &compiler, std::string_view attributeName) {
+  std::map<std::string, std::pair<std::string_view, std::string_view>> programs;
+  for (uint64_t i = 0; i < compiler.GetEntryPointCount(); i++) {
+    const auto *entryPoint = compiler.GetEntryPointByIndex(i);
+    const bool isVertex = entryPoint->Stage == BgfxSlang::StageType::Vertex;
+    if (!isVertex && entryPoint->Stage != BgfxSlang::StageType::Fragment) {
+      continue;
+    }
+    const auto tag = getEntryPointTag(*entryPoint, attributeName);
+    if (tag.empty()) {
+      continue;
+    }
+
+    auto &name = isVertex ? programs[tag].first : programs[tag].second;
+    if (!name.empty()) {
+      return BgfxSlang::Status{BgfxSlang::StatusCode::Error, "Entry points " + std::string(name) + " and " + entryPoint->Name +
+                                                                 " have the same stage and " + std::string(attributeName) + " tag: " + tag};
+    }
+    name = entryPoint->Name;
   }
 
+  for (const auto &[tag, names] : programs) {
+    if (names.first.empty() || names.second.empty()) {
+      continue;
+    }
+    if (auto status = compiler.LinkEntryPoints(names.first, names.second); status.IsError()) {
+      return status;
+    }
+  }
+  return BgfxSlang::Status{};
+}
+
+bool compileFile(const Options &options, const std::string &inputPath, BgfxSlang::GlobalSessionPool &globalSessionPool,
+                 uint32_t threadCount, FileDependencies &dependencies) {
+  const auto spanName = options.Trace != nullptr ? "compile file " + inputPath : std::string{};
+  BgfxSlang::ScopedSpan span(options.Trace, spanName);
+
   BgfxSlang::Compiler compiler;
-  BgfxSlang::ConsoleWriter writer;
+  LogWriter writer(*options.Out);
 
-  if (cmdLine.Has(BgfxSlangCmd::TokenType::Include)) {
-    for (const auto includePath : *cmdLine.Get(BgfxSlangCmd::TokenType::Include)) {
+  compiler.SetGlobalSessionPool(&globalSessionPool);
+  compiler.SetTraceSink(options.Trace);
+  compiler.SetCache(options.Cache);
+  compiler.SetModuleCache(options.ModuleCache);
+
+  if (options.Includes != nullptr) {
+    for (const auto includePath : *options.Includes) {
       compiler.AddModulesSearchPath(includePath);
     }
   }
 
-  if (verbose) {
+  if (options.Verbose) {
     compiler.SetVerboseWriter(&writer);
   }
 
-  for (const auto &target : *cmdLine.Get(BgfxSlangCmd::TokenType::Target)) {
-    printLog(verbose, "Adding target: " + std::string(target));
-    verifyStatus(compiler.AddTarget(target));
+  for (const auto &target : *options.Targets) {
+    printLog(*options.Out, options.Verbose, "Adding target: " + std::string(target));
+    if (!checkStatus(*options.Out, compiler.AddTarget(target, options.Optimizations.at(target)))) {
+      return false;
+    }
+  }
+
+  for (const auto &permutation : options.Permutations) {
+    if (!checkStatus(*options.Out, compiler.AddPermutation(permutation))) {
+      return false;
+    }
   }
+  compiler.SetUniformPacking(options.PackedUniforms);
+  compiler.SetUniformBufferCompaction(options.CompactUniforms);
 
-  auto inputPath = cmdLine.GetOne(BgfxSlangCmd::TokenType::Input);
-  printLog(verbose, "Loading program: " + std::string(inputPath) + "...");
-  verifyStatus(compiler.LoadProgramFromPath(inputPath));
+  printLog(*options.Out, options.Verbose, "Loading program: " + inputPath + "...");
+  if (!checkStatus(*options.Out, compiler.LoadProgramFromPath(inputPath))) {
+    return false;
+  }
   std::filesystem::path inputFilePath{inputPath};
+  dependencies.Inputs.push_back(inputPath);
+  dependencies.Inputs.insert(dependencies.Inputs.end(), compiler.GetDependencies().begin(), compiler.GetDependencies().end());
 
-  if (cmdLine.Has(BgfxSlangCmd::TokenType::StageType)) {
-    for (const auto &stageType : *cmdLine.Get(BgfxSlangCmd::TokenType::StageType)) {
-      printLog(verbose, "Adding stage type: " + std::string(stageType));
+  if (!options.PackedUniformsHeaderFormat.empty()) {
+    auto headerPath = BgfxSlangCmd::formatString(options.PackedUniformsHeaderFormat, {{"{{name}}", inputFilePath.stem().string()},
+                                                                                      {"{{filename}}", inputFilePath.filename().string()}});
+    if (!writePackedUniformsHeader(headerPath, inputFilePath, compiler.GetUniformPacking(), options)) {
+      return false;
+    }
+    dependencies.Outputs.push_back(std::move(headerPath));
+  }
+
+  if (options.Stages != nullptr) {
+    for (const auto &stageType : *options.Stages) {
+      printLog(*options.Out, options.Verbose, "Adding stage type: " + std::string(stageType));
       BgfxSlang::StageType stage = BgfxSlang::getStageTypeFromShortName(stageType);
-      verifyStatus(compiler.AddEntryPoint(stage));
+      if (!checkStatus(*options.Out, compiler.AddEntryPoint(stage))) {
+        return false;
+      }
+    }
+  }
+
+  if (!options.LinkTag.empty() && !checkStatus(*options.Out, linkEntryPoints(compiler, options.LinkTag))) {
+    return false;
+  }
+
+  std::vector<BgfxSlang::CompileJob> jobs;
+  std::vector<const BgfxSlang::EntryPoint *> jobEntryPoints;
+  for (int64_t permutationIdx = 0; permutationIdx < compiler.GetPermutationCount(); permutationIdx++) {
+    for (int64_t targetIdx = 0; targetIdx < compiler.GetTargetCount(); targetIdx++) {
+      for (uint64_t i = 0; i < compiler.GetEntryPointCount(); i++) {
+        const auto *entryPoint = compiler.GetEntryPointByIndex(i);
+        jobs.push_back({entryPoint->Idx, targetIdx, permutationIdx});
+        jobEntryPoints.push_back(entryPoint);
+      }
     }
   }
 
-  for (int64_t targetIdx = 0; targetIdx < targetCount; targetIdx++) {
+  // the watch mode compiles only the entry points whose hash changed since their outputs were written, the shader pack and the
+  // program bindings are written whole, so their shaders are always compiled (the hashes of their outputs are still recorded)
+  std::vector<std::string> jobHashes;
+  if (options.Watch != nullptr) {
+    const bool skipsUnchanged = options.Pack == nullptr && options.BindingsFormat.empty();
+    size_t keptCount = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+      const auto &job = jobs[i];
+      auto outputPath =
+          formatOutputPath(options.OutputFormat, inputFilePath, compiler.GetTarget(job.TargetIdx), *jobEntryPoints[i], job.PermutationIdx);
+      std::string hash{compiler.GetEntryPointHash(job.EntryPointIdx, job.TargetIdx)};
+      // linked shaders change with the entry point they are linked with
+      if (const auto linkedIdx = compiler.GetLinkedEntryPoint(job.EntryPointIdx); linkedIdx > -1) {
+        hash += compiler.GetEntryPointHash(linkedIdx, job.TargetIdx);
+      }
 
-    auto target = compiler.GetTarget(targetIdx);
+      bool unchanged = false;
+      if (skipsUnchanged) {
+        std::lock_guard lock(options.Watch->OutputHashesMutex);
+        const auto it = options.Watch->OutputHashes.find(outputPath);
+        unchanged = !hash.empty() && it != options.Watch->OutputHashes.end() && it->second == hash;
+      }
+      if (unchanged && std::filesystem::exists(outputPath)) {
+        printLog(*options.Out, options.Verbose, "Entry point '" + jobEntryPoints[i]->Name + "' unchanged, skipped: " + outputPath);
+        dependencies.Outputs.push_back(std::move(outputPath));
+        continue;
+      }
 
-    for (uint64_t i = 0; i < compiler.GetEntryPointCount(); i++) {
-      const auto *entryPoint = compiler.GetEntryPointByIndex(i);
+      jobs[keptCount] = job;
+      jobEntryPoints[keptCount] = jobEntryPoints[i];
+      jobHashes.push_back(std::move(hash));
+      keptCount++;
+    }
+    jobs.resize(keptCount);
+    jobEntryPoints.resize(keptCount);
+  }
 
-      std::string outputPath = formatOutputPath(outputFormat, inputFilePath, target, *entryPoint);
+  printLog(*options.Out, options.Verbose, "Compiling " + std::to_string(jobs.size()) + " shaders...");
+  auto results = compiler.CompileAll(jobs, threadCount);
 
-      printLog(verbose, "Compiling entry point '" + entryPoint->Name + "' (" +
-                            std::string(BgfxSlang::getStageShortName(entryPoint->Stage)) + ") to: " + outputPath);
+  bool succeeded = true;
+  std::map<std::pair<int64_t, int64_t>, BgfxSlang::ProgramBindingsWriter> bindings;
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto &result = results[i];
+    const auto *entryPoint = jobEntryPoints[i];
+    auto target = compiler.GetTarget(result.TargetIdx);
 
-      std::unique_ptr<BgfxSlang::FileWriter> writer;
-      if (bin2C) {
-        writer = std::make_unique<BgfxSlang::Bin2cWriter>(formatHeaderVarName(bin2CVarFormat, inputFilePath, target, *entryPoint));
-      } else {
-        writer = std::make_unique<BgfxSlang::FileWriter>();
+    std::string outputPath = options.Pack != nullptr
+                                 ? "shader pack"
+                                 : formatOutputPath(options.OutputFormat, inputFilePath, target, *entryPoint, result.PermutationIdx);
+
+    printLog(*options.Out, options.Verbose, "Writing entry point '" + entryPoint->Name + "' (" +
+                                  std::string(BgfxSlang::getStageShortName(entryPoint->Stage)) + ") to: " + outputPath);
+    if (!checkStatus(*options.Out, result.Result)) {
+      succeeded = false;
+      continue;
+    }
+
+    // identical permutations are compiled once, the data is kept only in the first result
+    const auto &data = result.DuplicateOf < 0 ? result.Data : results[result.DuplicateOf].Data;
+
+    if (!options.BindingsFormat.empty()) {
+      BgfxSlang::ShaderReflection reflection;
+      if (!BgfxSlang::readShaderReflection(data, target.Format, reflection)) {
+        std::lock_guard lock(outputMutex);
+        *options.Out << "Failed to read reflection of entry point: " << entryPoint->Name << '\n';
+        succeeded = false;
+        continue;
       }
-      std::filesystem::create_directory(std::filesystem::path{outputPath}.parent_path());
-      if (!writer->Open(outputPath)) {
-        std::cerr << "Failed to open file: " << outputPath << '\n';
-        exit(1);
+      bindings[{result.TargetIdx, result.PermutationIdx}].AddShader(entryPoint->Name, reflection.Stage, reflection.Attributes,
+                                                                    reflection.Uniforms);
+    }
+
+    if (options.Pack != nullptr) {
+      const auto name = inputFilePath.stem().string();
+      const auto tag = options.PackTag.empty() ? std::string{} : getEntryPointTag(*entryPoint, options.PackTag);
+      std::unique_lock lock(packMutex, std::defer_lock);
+      {
+        BgfxSlang::ScopedSpan lockSpan(options.Trace, "pack lock");
+        lock.lock();
       }
-      verifyStatus(compiler.Compile(entryPoint->Idx, targetIdx, *writer));
-      writer->Close();
+      options.Pack->Add({name, entryPoint->Name, BgfxSlang::getStageShortName(entryPoint->Stage), BgfxSlang::GetTargetShortName(target),
+                         tag, static_cast<uint32_t>(result.PermutationIdx)},
+                        data);
+      continue;
+    }
+
+    std::unique_ptr<BgfxSlang::FileWriter> writer;
+    if (options.Bin2C) {
+      writer = std::make_unique<BgfxSlang::Bin2cWriter>(
+          formatHeaderVarName(options.Bin2CVarFormat, inputFilePath, target, *entryPoint, result.PermutationIdx), options.Bin2CFormat);
+    } else {
+      writer = std::make_unique<BgfxSlang::FileWriter>();
+    }
+    BgfxSlang::ScopedSpan writeSpan(options.Trace, "write file");
+    std::filesystem::create_directory(std::filesystem::path{outputPath}.parent_path());
+    writer->Open(outputPath);
+    // results outlive the writer, the file writer references the data
+    writer->WriteShared(data, nullptr);
+    if (!writer->Close()) {
+      std::lock_guard lock(outputMutex);
+      *options.Out << "Failed to write file: " << outputPath << '\n';
+      succeeded = false;
+      continue;
+    }
+    if (writer->IsUnchanged()) {
+      printLog(*options.Out, options.Verbose, "   Unchanged, skipped writing: " + outputPath);
+    }
+    if (options.Watch != nullptr && i < jobHashes.size()) {
+      std::lock_guard lock(options.Watch->OutputHashesMutex);
+      options.Watch->OutputHashes[outputPath] = jobHashes[i];
+    }
+    dependencies.Outputs.push_back(std::move(outputPath));
+  }
+
+  for (const auto &[key, programBindings] : bindings) {
+    const auto &[targetIdx, permutationIdx] = key;
+    auto bindingsPath = formatBindingsPath(options.BindingsFormat, inputFilePath, compiler.GetTarget(targetIdx), permutationIdx);
+    printLog(*options.Out, options.Verbose, "Writing program bindings to: " + bindingsPath);
+    BgfxSlang::ScopedSpan writeSpan(options.Trace, "write bindings");
+    if (!writeBindings(bindingsPath, programBindings, options)) {
+      succeeded = false;
+      continue;
+    }
+    dependencies.Outputs.push_back(std::move(bindingsPath));
+  }
+  return succeeded;
+}
+
+// Escapes a path for the Make/Ninja depfile syntax.
+std::string escapeDepfilePath(const std::string &path) {
+  std::string escaped;
+  escaped.reserve(path.size());
+  for (const char c : path) {
+    if (c == ' ' || c == '#') {
+      escaped += '\\';
+    } else if (c == '$') {
+      escaped += '$';
     }
+    escaped += c;
   }
-}
\ No newline at end of file
+  return escaped;
+}
+
+// Single rule with all the outputs depending on all the inputs, so one depfile covers the batch compilation as well.
+// Paths are absolute as the build tool may resolve them from other directory than the tool working directory.
+bool writeDepfile(std::string_view path, const std::vector<FileDependencies> &dependencies) {
+  std::string content;
+  for (const auto &file : dependencies) {
+    for (const auto &output : file.Outputs) {
+      content += content.empty() ? "" : " ";
+      content += escapeDepfilePath(std::filesystem::absolute(output).generic_string());
+    }
+  }
+  content += ":";
+  for (const auto &file : dependencies) {
+    for (const auto &input : file.Inputs) {
+      content += " \\\n  " + escapeDepfilePath(std::filesystem::absolute(input).generic_string());
+    }
+  }
+  content += "\n";
+
+  BgfxSlang::FileWriter writer;
+  writer.Open(path);
+  writer.Write(content);
+  return writer.Close();
+}
+
+// With bin2c the pack is written as C header, the variable name is formatted with {{name}} of the pack file.
+bool writePack(const std::string &path, const BgfxSlang::ShaderPackWriter &pack, const Options &options, std::ostream &out) {
+  BgfxSlang::ScopedSpan span(options.Trace, "write pack");
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path{path}.parent_path(), error);
+
+  std::unique_ptr<BgfxSlang::FileWriter> writer;
+  if (options.Bin2C) {
+    writer = std::make_unique<BgfxSlang::Bin2cWriter>(
+        BgfxSlangCmd::formatString(options.Bin2CVarFormat, {{"{{name}}", std::filesystem::path{path}.stem().string()}}),
+        options.Bin2CFormat);
+  } else {
+    writer = std::make_unique<BgfxSlang::FileWriter>();
+  }
+  writer->Open(path);
+  if (!checkStatus(out, pack.Write(*writer))) {
+    writer->Discard();
+    return false;
+  }
+  if (!writer->Close()) {
+    out << "Failed to write file: " << path << '\n';
+    return false;
+  }
+  return true;
+}
+
+std::string normalizePath(const std::string &path) { return std::filesystem::absolute(path).lexically_normal().string(); }
+
+// Inputs not depending on any of the changed files keep their previous outputs, their dependencies are moved to unchangedDependencies.
+void removeUnchangedInputs(const WatchState &watch, std::vector<std::string> &inputPaths,
+                           std::vector<FileDependencies> &unchangedDependencies) {
+  std::erase_if(inputPaths, [&](const std::string &inputPath) {
+    const auto it = watch.Dependencies.find(inputPath);
+    // failed loads have no dependencies, they are built again on any change
+    if (it == watch.Dependencies.end() || it->second.Inputs.empty()) {
+      return false;
+    }
+    for (const auto &dependency : it->second.Inputs) {
+      if (std::ranges::find(watch.ChangedPaths, normalizePath(dependency)) != watch.ChangedPaths.end()) {
+        return false;
+      }
+    }
+    unchangedDependencies.push_back(it->second);
+    return true;
+  });
+}
+
+// Runs the tool for the command line, messages are written to out. Returns the process exit code.
+// The in-memory module cache is used when the compile cache is not enabled, with the compile cache the modules are stored on disk too.
+// In watch mode only the inputs and entry points affected by the changed files are built.
+int run(const BgfxSlangCmd::CmdLine &cmdLine, BgfxSlang::GlobalSessionPool &globalSessionPool, BgfxSlang::ModuleCache &moduleCache,
+        std::ostream &out, WatchState *watch = nullptr) {
+  if (!validateArgs(cmdLine, out)) {
+    return 1;
+  }
+
+  Options options;
+  options.Out = &out;
+  options.OutputFormat = cmdLine.GetOne(BgfxSlangCmd::TokenType::Output, options.OutputFormat);
+  options.Verbose = cmdLine.Has(BgfxSlangCmd::TokenType::Verbose);
+  options.Bin2C = cmdLine.Has(BgfxSlangCmd::TokenType::Bin2C);
+  options.Bin2CVarFormat = cmdLine.GetOne(BgfxSlangCmd::TokenType::Bin2C, options.Bin2CVarFormat);
+  options.Bin2CFormat = BgfxSlang::getBin2cFormatFromName(cmdLine.GetOne(BgfxSlangCmd::TokenType::Bin2CFormat, "ascii"));
+  if (options.Bin2CFormat == BgfxSlang::Bin2cFormat::Unknown) {
+    out << "Invalid bin2c format: " << cmdLine.GetOne(BgfxSlangCmd::TokenType::Bin2CFormat) << '\n';
+    return 1;
+  }
+  options.Targets = cmdLine.Get(BgfxSlangCmd::TokenType::Target);
+  options.Includes = cmdLine.Get(BgfxSlangCmd::TokenType::Include);
+  options.Stages = cmdLine.Get(BgfxSlangCmd::TokenType::StageType);
+  options.Watch = watch;
+  options.BindingsFormat = cmdLine.GetOne(BgfxSlangCmd::TokenType::Bindings);
+  options.LinkTag = cmdLine.GetOne(BgfxSlangCmd::TokenType::Link);
+  options.PackedUniforms = cmdLine.GetOne(BgfxSlangCmd::TokenType::PackedUniforms);
+  options.PackedUniformsHeaderFormat = cmdLine.GetOne(BgfxSlangCmd::TokenType::PackedUniformsHeader);
+  options.CompactUniforms = cmdLine.Has(BgfxSlangCmd::TokenType::CompactUniforms);
+  if (!parseOptimizations(cmdLine, out, options)) {
+    return 1;
+  }
+  if (!options.PackedUniformsHeaderFormat.empty() && options.PackedUniforms.empty()) {
+    out << "Packed uniforms header needs --packed-uniforms\n";
+    return 1;
+  }
+
+  if (const auto *permutations = cmdLine.Get(BgfxSlangCmd::TokenType::Permutation); permutations != nullptr) {
+    for (const auto &value : *permutations) {
+      if (!parsePermutation(value, options.Permutations.emplace_back())) {
+        out << "Invalid permutation: " << value << '\n';
+        return 1;
+      }
+    }
+    // pack entries are keyed by the permutation index
+    const bool hasPermutationPath = cmdLine.Has(BgfxSlangCmd::TokenType::Pack) ||
+                                    (options.OutputFormat.find("{{permutation}}") != std::string_view::npos &&
+                                     (!options.Bin2C || options.Bin2CVarFormat.find("{{permutation}}") != std::string_view::npos));
+    if (options.Permutations.size() > 1 && !hasPermutationPath) {
+      out << "Output path and header variable name need {{permutation}} when multiple permutations are compiled\n";
+      return 1;
+    }
+    if (options.Permutations.size() > 1 && !options.BindingsFormat.empty() &&
+        options.BindingsFormat.find("{{permutation}}") == std::string_view::npos) {
+      out << "Program bindings path needs {{permutation}} when multiple permutations are compiled\n";
+      return 1;
+    }
+  }
+
+  BgfxSlang::ShaderPackWriter pack;
+  if (cmdLine.Has(BgfxSlangCmd::TokenType::Pack)) {
+    options.Pack = &pack;
+    options.PackTag = cmdLine.GetOne(BgfxSlangCmd::TokenType::PackTag);
+    // single variable for the whole pack
+    options.Bin2CVarFormat = cmdLine.GetOne(BgfxSlangCmd::TokenType::Bin2C, "{{name}}");
+
+    const auto compressionName = cmdLine.GetOne(BgfxSlangCmd::TokenType::PackCompression, "none");
+    if (compressionName != "none" && compressionName != "zstd") {
+      out << "Invalid shader pack compression: " << compressionName << '\n';
+      return 1;
+    }
+    const auto compression = compressionName == "zstd" ? BgfxSlang::ShaderPackCompression::Zstd : BgfxSlang::ShaderPackCompression::None;
+    int compressionLevel = BgfxSlang::ShaderPackWriter::defaultCompressionLevel;
+    if (cmdLine.Has(BgfxSlangCmd::TokenType::PackCompressionLevel)) {
+      int64_t level = 0;
+      if (!parseInt(cmdLine.GetOne(BgfxSlangCmd::TokenType::PackCompressionLevel), level) || level < std::numeric_limits<int>::min() ||
+          level > std::numeric_limits<int>::max()) {
+        out << "Invalid shader pack compression level: " << cmdLine.GetOne(BgfxSlangCmd::TokenType::PackCompressionLevel) << '\n';
+        return 1;
+      }
+      compressionLevel = static_cast<int>(level);
+    }
+    if (!checkStatus(out, pack.SetCompression(compression, compressionLevel))) {
+      return 1;
+    }
+  }
+
+  std::unique_ptr<BgfxSlang::CompileCache> cache;
+  if (cmdLine.Has(BgfxSlangCmd::TokenType::CacheDir)) {
+    cache = std::make_unique<BgfxSlang::CompileCache>(cmdLine.GetOne(BgfxSlangCmd::TokenType::CacheDir));
+  } else if (cmdLine.Has(BgfxSlangCmd::TokenType::Cache)) {
+    cache = std::make_unique<BgfxSlang::CompileCache>(BgfxSlang::CompileCache::GetDefaultDirectory());
+  }
+  if (cache) {
+    printLog(out, options.Verbose, "Using compile cache: " + cache->GetDirectory().string());
+    options.Cache = cache.get();
+  }
+
+  std::unique_ptr<BgfxSlang::ChromeTraceSink> trace;
+  if (cmdLine.Has(BgfxSlangCmd::TokenType::Trace)) {
+    trace = std::make_unique<BgfxSlang::ChromeTraceSink>();
+    options.Trace = trace.get();
+  }
+
+  std::unique_ptr<BgfxSlang::ModuleCache> diskModuleCache;
+  if (!cmdLine.Has(BgfxSlangCmd::TokenType::NoModuleCache)) {
+    if (cache) {
+      diskModuleCache = std::make_unique<BgfxSlang::ModuleCache>(cache.get());
+    }
+    options.ModuleCache = diskModuleCache ? diskModuleCache.get() : &moduleCache;
+  }
+
+  uint32_t threadCount = 1;
+  if (cmdLine.Has(BgfxSlangCmd::TokenType::Jobs)) {
+    // 0 - hardware concurrency
+    constexpr int64_t maxJobs = 1024;
+    int64_t jobs = 0;
+    if (!parseInt(cmdLine.GetOne(BgfxSlangCmd::TokenType::Jobs), jobs) || jobs < 0 || jobs > maxJobs) {
+      out << "Invalid job count: " << cmdLine.GetOne(BgfxSlangCmd::TokenType::Jobs) << ", expected 0 to " << maxJobs << '\n';
+      return 1;
+    }
+    threadCount = static_cast<uint32_t>(jobs);
+  }
+  if (threadCount == 0) {
+    threadCount = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  std::vector<std::string> inputPaths;
+  if (!getInputPaths(cmdLine, out, inputPaths)) {
+    return 1;
+  }
+
+  std::vector<FileDependencies> unchangedDependencies;
+  if (watch != nullptr && options.Pack == nullptr && !watch->ChangedPaths.empty()) {
+    removeUnchangedInputs(*watch, inputPaths, unchangedDependencies);
+  }
+
+  // single file uses all the threads for its entry points and targets, multiple files are spread across the threads
+  std::vector<FileDependencies> dependencies(inputPaths.size());
+  std::atomic<bool> succeeded = true;
+  if (inputPaths.size() == 1) {
+    succeeded = compileFile(options, inputPaths.front(), globalSessionPool, threadCount, dependencies.front());
+  } else {
+    std::atomic<size_t> nextInput = 0;
+    auto worker = [&]() {
+      for (size_t i = nextInput++; i < inputPaths.size(); i = nextInput++) {
+        if (!compileFile(options, inputPaths[i], globalSessionPool, 1, dependencies[i])) {
+          succeeded = false;
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min<size_t>(threadCount, inputPaths.size()); i++) {
+      threads.emplace_back(worker);
+    }
+    worker();
+
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  if (watch != nullptr) {
+    for (size_t i = 0; i < inputPaths.size(); i++) {
+      watch->Dependencies[inputPaths[i]] = dependencies[i];
+    }
+  }
+  dependencies.insert(dependencies.end(), unchangedDependencies.begin(), unchangedDependencies.end());
+
+  if (succeeded && options.Pack != nullptr) {
+    const auto packPath = std::string(cmdLine.GetOne(BgfxSlangCmd::TokenType::Pack));
+    printLog(out, options.Verbose, "Writing shader pack with " + std::to_string(pack.GetEntryCount()) + " shaders (" +
+                                       std::to_string(pack.GetBlobCount()) + " unique) to: " + packPath);
+    if (writePack(packPath, pack, options, out)) {
+      dependencies.push_back({{packPath}, {}});
+    } else {
+      succeeded = false;
+    }
+  }
+
+  // failed compilations leave the outputs missing, so the build reruns the tool without the depfile
+  if (succeeded && cmdLine.Has(BgfxSlangCmd::TokenType::Depfile)) {
+    const auto depfilePath = cmdLine.GetOne(BgfxSlangCmd::TokenType::Depfile);
+    if (!writeDepfile(depfilePath, dependencies)) {
+      out << "Failed to write depfile: " << depfilePath << '\n';
+      succeeded = false;
+    }
+  }
+
+  // written for the failed runs too, they are often the ones worth looking at
+  if (trace) {
+    const auto tracePath = std::string(cmdLine.GetOne(BgfxSlangCmd::TokenType::Trace));
+    BgfxSlang::FileWriter writer;
+    writer.Open(tracePath);
+    trace->WriteTo(writer);
+    if (!writer.Close()) {
+      out << "Failed to write trace: " << tracePath << '\n';
+      succeeded = false;
+    }
+  }
+
+  return succeeded ? 0 : 1;
+}
+
+// Keeps the global sessions warm between requests. Requests are handled one at a time as relative paths are resolved by changing
+// the working directory, every request can still use multiple threads.
+int runServer(std::string_view socketPath) {
+  BgfxSlang::GlobalSessionPool globalSessionPool;
+  BgfxSlang::ModuleCache moduleCache;
+  const auto serverDirectory = std::filesystem::current_path();
+
+  auto handler = [&](const BgfxSlangCmd::ServerRequest &request) {
+    BgfxSlangCmd::ServerResponse response;
+    std::ostringstream out;
+
+    std::error_code error;
+    std::filesystem::current_path(request.WorkingDirectory, error);
+    if (error) {
+      response.Output = "Invalid working directory: " + request.WorkingDirectory + "\n";
+      return response;
+    }
+
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>("bgfx-slang-cmd"));
+    for (const auto &arg : request.Args) {
+      argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+
+    BgfxSlangCmd::CmdLine cmdLine(static_cast<int>(argv.size()), argv.data());
+    response.ExitCode = run(cmdLine, globalSessionPool, moduleCache, out);
+    response.Output = std::move(out).str();
+
+    std::filesystem::current_path(serverDirectory, error);
+    return response;
+  };
+
+  return BgfxSlangCmd::serve(socketPath, handler, std::cout) ? 0 : 1;
+}
+
+// Builds all the inputs and then, until SIGINT or SIGTERM, rebuilds the ones depending on the files changed since. The global sessions
+// and imported modules stay loaded between the builds.
+int runWatch(const BgfxSlangCmd::CmdLine &cmdLine) {
+  BgfxSlang::GlobalSessionPool globalSessionPool;
+  BgfxSlang::ModuleCache moduleCache;
+  WatchState state;
+
+  // inputs are watched even when their load failed, so fixing the error rebuilds them
+  auto getWatchedPaths = [&]() {
+    std::vector<std::string> paths;
+    for (const auto &[inputPath, dependencies] : state.Dependencies) {
+      paths.push_back(inputPath);
+      paths.insert(paths.end(), dependencies.Inputs.begin(), dependencies.Inputs.end());
+    }
+    return paths;
+  };
+
+  int exitCode = run(cmdLine, globalSessionPool, moduleCache, std::cout, &state);
+  if (state.Dependencies.empty()) {
+    return exitCode;
+  }
+
+  auto handler = [&](const std::vector<std::string> &changedPaths) {
+    for (const auto &path : changedPaths) {
+      std::cout << "Changed: " << path << '\n';
+    }
+    state.ChangedPaths = changedPaths;
+    exitCode = run(cmdLine, globalSessionPool, moduleCache, std::cout, &state);
+    std::cout << (exitCode == 0 ? "Build succeeded\n" : "Build failed\n");
+    return getWatchedPaths();
+  };
+
+  return BgfxSlangCmd::watch(getWatchedPaths(), handler, std::cout) ? exitCode : 1;
+}
+
+// Forwards the command line without the --connect option. Returns false when the server is not available.
+bool runClient(int argc, char **argv, std::string_view socketPath, int &exitCode) {
+  BgfxSlangCmd::ServerRequest request;
+  request.WorkingDirectory = std::filesystem::current_path().string();
+  for (int i = 1; i < argc; i++) {
+    if (std::string_view{argv[i]} == "--connect") {
+      i++;
+      continue;
+    }
+    request.Args.emplace_back(argv[i]);
+  }
+
+  BgfxSlangCmd::ServerResponse response;
+  if (!BgfxSlangCmd::sendRequest(socketPath, request, response)) {
+    return false;
+  }
+  std::cout << response.Output;
+  exitCode = response.ExitCode;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  BgfxSlangCmd::CmdLine cmdLine(argc, argv);
+
+  if (cmdLine.Has(BgfxSlangCmd::TokenType::Serve)) {
+    if (cmdLine.Has(BgfxSlangCmd::TokenType::Watch)) {
+      std::cout << "Watch mode can't be used with --serve\n";
+      return 1;
+    }
+    return runServer(cmdLine.GetOne(BgfxSlangCmd::TokenType::Serve));
+  }
+
+  if (cmdLine.Has(BgfxSlangCmd::TokenType::Watch)) {
+    // the watch mode keeps its state in this process, it can't be served or forwarded
+    if (cmdLine.Has(BgfxSlangCmd::TokenType::Connect)) {
+      std::cout << "Watch mode can't be used with --connect\n";
+      return 1;
+    }
+    return runWatch(cmdLine);
+  }
+
+  if (cmdLine.Has(BgfxSlangCmd::TokenType::Connect)) {
+    int exitCode = 1;
+    const auto socketPath = cmdLine.GetOne(BgfxSlangCmd::TokenType::Connect);
+    if (runClient(argc, argv, socketPath, exitCode)) {
+      return exitCode;
+    }
+    printLog(std::cout, cmdLine.Has(BgfxSlangCmd::TokenType::Verbose),
+             "Server is not available at: " + std::string(socketPath) + ", compiling locally");
+  }
+
+  BgfxSlang::GlobalSessionPool globalSessionPool;
+  BgfxSlang::ModuleCache moduleCache;
+  return run(cmdLine, globalSessionPool, moduleCache, std::cout);
+}